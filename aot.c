@@ -0,0 +1,323 @@
+/**
+ * Author: Wang Renxin, hellotony521@qq.com
+ * For the latest info, see https://github.com/paladin-t/xpl/
+ * Created:     Oct. 14, 2011
+ * Last edited: Jun. 17, 2017
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+/**
+ * Equivalence harness of xpl_translate, runs in two passes:
+ *   cc aot.c -o aot && ./aot > aot.inc
+ *   cc -DAOT_GENERATED aot.c -o aot && ./aot
+ * The first pass translates the scripts of test.c and generated ones, the
+ * second pass runs every translated function and the interpreter with one
+ * and three lanes, and compares their call logs and statuses.
+ */
+
+#include "xpl.h"
+
+#define AOT_GENERATED_SCRIPTS 200
+
+static char aot_log[1 << 14];
+
+static int aot_log_length;
+
+static void _aot_log(const char* _t) {
+  int n = (int)strlen(_t);
+  if(aot_log_length + n + 2 > (int)sizeof(aot_log)) return;
+  memcpy(aot_log + aot_log_length, _t, n);
+  aot_log_length += n;
+  aot_log[aot_log_length++] = ' ';
+  aot_log[aot_log_length] = '\0';
+}
+
+static void _aot_log_params(xpl_context_t* _s) {
+  char buf[64] = { '\0' };
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_string(_s, buf, sizeof(buf)) != XS_OK) break;
+    _aot_log(buf);
+  }
+}
+
+static xpl_status_t test1(xpl_context_t* _s) {
+  char buf[64] = { '\0' };
+  double f = 0.0;
+  _aot_log("test1");
+  if(xpl_has_param(_s) == XS_OK) {
+    xpl_pop_double(_s, &f);
+    sprintf(buf, "%g", f);
+    _aot_log(buf);
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t test3(xpl_context_t* _s) {
+  char buf[64] = { '\0' };
+  xpl_int64_t v = 0;
+  _aot_log("test3");
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_int64(_s, &v) != XS_OK) break;
+    sprintf(buf, "%lld", (long long)v);
+    _aot_log(buf);
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t test4(xpl_context_t* _s) {
+  char buf[64] = { '\0' };
+  xpl_string_view_t view;
+  _aot_log("test4");
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_string_view(_s, &view, buf, sizeof(buf)) != XS_OK) break;
+    _aot_log(view.ptr == buf ? "decoded" : "view");
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t test5(xpl_context_t* _s) {
+  char buf[32] = { '\0' };
+  xpl_lanes_t lanes = 0;
+  xpl_active_lanes(_s, &lanes);
+  sprintf(buf, "test5:%x", (unsigned)lanes);
+  _aot_log(buf);
+
+  return XS_OK;
+}
+
+static xpl_status_t t(xpl_context_t* _s) {
+  _aot_log("t");
+  _aot_log_params(_s);
+
+  return XS_OK;
+}
+
+static xpl_status_t cond1(xpl_context_t* _s) {
+  _aot_log("cond1");
+
+  return xpl_push_bool(_s, 0);
+}
+
+static xpl_status_t cond2(xpl_context_t* _s) {
+  _aot_log("cond2");
+
+  return xpl_push_bool(_s, 1);
+}
+
+static xpl_status_t cond3(xpl_context_t* _s) {
+  _aot_log("cond3");
+
+  return xpl_push_lanes(_s, 0x5);
+}
+
+static xpl_status_t cond4(xpl_context_t* _s) {
+  long v = 0;
+  xpl_pop_long(_s, &v);
+  _aot_log("cond4");
+
+  return xpl_push_bool(_s, v > 1);
+}
+
+static xpl_status_t ca(xpl_context_t* _s) {
+  long v = 0;
+  xpl_pop_long(_s, &v);
+  _aot_log("ca");
+
+  return xpl_push_lanes(_s, (xpl_lanes_t)v);
+}
+
+static xpl_context_t xpl;
+
+#ifndef AOT_GENERATED
+static xpl_instr_t code[1024];
+
+static const char* aot_scripts[] = {
+  "if cond1 then test1 3.14 elseif cond2 then test1 2 else test3 endif",
+  "if cond1 then if cond2 3 then test3 elseif cond2 then test3 endif test3 endif test1 2.5",
+  "if cond1 and cond2 3 then test3 elseif cond2 or cond1 then test3 4 endif",
+  "if cond4 1 then test3 1 elseif cond4 2 then if cond4 1 or cond4 2 then test3 2 endif endif",
+  "test3 42 -0x7f 0b1010 9223372036854775807",
+  "test3 1 2 3 test3 4 5 6",
+  "test4 hello \"hello world\" \"hello \\\"world\\\"\"",
+  "if cond1 then test1 3.14 elseif cond2 then test4 \"hello world\" else test3 endif 'a comment longer than the window' test3 1 2 3",
+  "if cond2 then test3 1 if cond1 then test3 0 else yield test3 2 endif yield test3 3 endif",
+  "test5 if cond3 then test5 elseif cond2 then test5 endif test5",
+  "test3 1 if cond1 then test3 2 'skipped' test3 3 test3 4 elseif cond2 then test3 5 else test3 6 endif test3 7"
+};
+
+static char src[8192];
+
+static int src_length;
+
+static unsigned seed = 1;
+
+static unsigned _aot_rand(void) {
+  seed = seed * 1103515245u + 12345u;
+
+  return (seed >> 16) & 0x7fff;
+}
+
+static void _aot_emit(const char* _t) {
+  src_length += sprintf(src + src_length, "%s", _t);
+}
+
+static void _aot_gen_cond(void) {
+  int n = 1 + _aot_rand() % 3;
+  int i = 0;
+  for(i = 0; i < n; i++) {
+    if(i) _aot_emit(_aot_rand() % 2 ? " and " : " or ");
+    switch(_aot_rand() % 4) {
+      case 0: _aot_emit("cond1"); break;
+      case 1: _aot_emit("cond2"); break;
+      case 2: src_length += sprintf(src + src_length, "cond4 %u", _aot_rand() % 4); break;
+      default: src_length += sprintf(src + src_length, "ca %u", _aot_rand() % 8); break;
+    }
+  }
+}
+
+static void _aot_gen_body(int _d) {
+  int n = _aot_rand() % 4;
+  int i = 0;
+  int j = 0;
+  for(i = 0; i < n; i++) {
+    switch(_aot_rand() % 6) {
+      case 0:
+        if(_d >= 4) break;
+        _aot_emit(" if ");
+        _aot_gen_cond();
+        _aot_emit(" then");
+        _aot_gen_body(_d + 1);
+        for(j = _aot_rand() % 3; j > 0; j--) {
+          _aot_emit(" elseif ");
+          _aot_gen_cond();
+          _aot_emit(" then");
+          _aot_gen_body(_d + 1);
+        }
+        if(_aot_rand() % 2) {
+          _aot_emit(" else");
+          _aot_gen_body(_d + 1);
+        }
+        _aot_emit(" endif");
+        break;
+      case 1:
+        _aot_emit(" 'comment'");
+        break;
+      case 2:
+        _aot_emit(" test5");
+        break;
+      default:
+        _aot_emit(" t");
+        if(_aot_rand() % 2) src_length += sprintf(src + src_length, " %u", _aot_rand() % 100);
+        if(_aot_rand() % 3 == 0) _aot_emit(" \"s p\"");
+        if(_aot_rand() % 3 == 0) _aot_emit(",");
+        if(_aot_rand() % 4 == 0) _aot_emit(" yield");
+        break;
+    }
+  }
+}
+
+static xpl_status_t _aot_translate(const char* _t, int _k) {
+  char name[32] = { '\0' };
+  sprintf(name, "aot_%d", _k);
+  xpl_load(&xpl, _t);
+
+  return xpl_translate(&xpl, code, _countof(code), name, stdout);
+}
+#else /* AOT_GENERATED */
+static char aot_expected[sizeof(aot_log)];
+
+static xpl_status_t _aot_run(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  while((ret = xpl_run(_s)) == XS_SUSPENT)
+    _aot_log("|");
+
+  return ret;
+}
+
+static xpl_status_t _aot_run_translated(xpl_context_t* _s, xpl_func_t _f) {
+  xpl_status_t ret = XS_OK;
+  while((ret = _f(_s)) == XS_SUSPENT)
+    _aot_log("|");
+
+  return ret;
+}
+
+#  include "aot.inc"
+#endif /* AOT_GENERATED */
+
+int main() {
+  int i = 0;
+  int bad = 0;
+#ifdef AOT_GENERATED
+  int lanes = 0;
+  xpl_status_t expected = XS_OK;
+  xpl_status_t ret = XS_OK;
+#endif /* AOT_GENERATED */
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("test1", test1)
+    XPL_FUNC_ADD("test3", test3)
+    XPL_FUNC_ADD("test4", test4)
+    XPL_FUNC_ADD("test5", test5)
+    XPL_FUNC_ADD("t", t)
+    XPL_FUNC_ADD("cond1", cond1)
+    XPL_FUNC_ADD("cond2", cond2)
+    XPL_FUNC_ADD("cond3", cond3)
+    XPL_FUNC_ADD_FLAGS("cond4", cond4, XFF_PURE)
+    XPL_FUNC_ADD("ca", ca)
+  XPL_FUNC_END
+
+  xpl_open(&xpl, funcs, NULL);
+#ifndef AOT_GENERATED
+  printf("/* Generated by aot.c, do not edit. */\n\n");
+  for(i = 0; i < (int)_countof(aot_scripts); i++) {
+    if(_aot_translate(aot_scripts[i], i) != XS_OK) return 1;
+    printf("\n");
+  }
+  for(i = 0; i < AOT_GENERATED_SCRIPTS; i++) {
+    seed = (unsigned)i + 1;
+    src_length = 0;
+    _aot_gen_body(0);
+    if(_aot_translate(src, (int)_countof(aot_scripts) + i) != XS_OK) return 1;
+    printf("\n");
+  }
+  printf("static xpl_func_t aot_funcs[] = {\n");
+  for(i = 0; i < (int)_countof(aot_scripts) + AOT_GENERATED_SCRIPTS; i++)
+    printf("  aot_%d,\n", i);
+  printf("};\n\nstatic const char* aot_texts[] = {\n");
+  for(i = 0; i < (int)_countof(aot_scripts) + AOT_GENERATED_SCRIPTS; i++)
+    printf("  aot_%d_text,\n", i);
+  printf("};\n");
+#else /* AOT_GENERATED */
+  for(i = 0; i < (int)_countof(aot_funcs); i++) {
+    for(lanes = 1; lanes <= 3; lanes += 2) {
+      aot_log_length = 0;
+      aot_log[0] = '\0';
+      xpl_load(&xpl, aot_texts[i]);
+      xpl_set_lanes(&xpl, lanes);
+      expected = _aot_run(&xpl);
+      memcpy(aot_expected, aot_log, aot_log_length + 1);
+      aot_log_length = 0;
+      aot_log[0] = '\0';
+      xpl_unload(&xpl);
+      ret = _aot_run_translated(&xpl, aot_funcs[i]);
+      xpl_set_lanes(&xpl, 1);
+      if(ret != expected || strcmp(aot_log, aot_expected)) {
+        printf("mismatch aot_%d, lanes %d\n  %s\n  %s\n", i, lanes, aot_expected, aot_log);
+        bad++;
+      }
+    }
+  }
+  printf("translated %d scripts, %d mismatched\n", (int)_countof(aot_funcs), bad);
+#endif /* AOT_GENERATED */
+  xpl_close(&xpl);
+
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,894 @@
+/**
+ * Author: Wang Renxin, hellotony521@qq.com
+ * For the latest info, see https://github.com/paladin-t/xpl/
+ * Created:     Oct. 14, 2011
+ * Last edited: Jun. 17, 2017
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+# define _POSIX_C_SOURCE 199309L
+#endif /* !_WIN32 && !_POSIX_C_SOURCE && !_GNU_SOURCE */
+
+#include <time.h>
+#if defined(_WIN32)
+# include <windows.h>
+#endif /* _WIN32 */
+#include "xpl.h"
+
+#define BENCH_LOOKUPS 2000000
+
+static double _bench_now(void) {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static double _bench_wall(void) {
+#if defined(_WIN32)
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+
+  return (double)c.QuadPart / (double)f.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+  return _bench_now();
+#endif
+}
+
+static unsigned _bench_rand(unsigned* _r) {
+  *_r = *_r * 1103515245u + 12345u;
+
+  return (*_r >> 8) & 0xffffff;
+}
+
+static int _bench_sort_cmp(const void* _l, const void* _r) {
+  return strcmp(((const xpl_func_info_t*)_l)->name, ((const xpl_func_info_t*)_r)->name);
+}
+
+static int _bench_search_cmp(const void* _k, const void* _i) {
+  return strcmp((const char*)_k, ((const xpl_func_info_t*)_i)->name);
+}
+
+static xpl_status_t _bench_nop(xpl_context_t* _s) {
+  (void)_s;
+
+  return XS_OK;
+}
+
+static xpl_status_t _bench_true(xpl_context_t* _s) {
+  return xpl_push_bool(_s, 1);
+}
+
+static xpl_context_t xpl;
+
+static void bench_dispatch(int _n) {
+  xpl_func_info_t* funcs = NULL;
+  xpl_func_info_t* sorted = NULL;
+  char* names = NULL;
+  const char** keys = NULL;
+  const xpl_func_info_t* f = NULL;
+  unsigned r = 1;
+  long hits = 0;
+  int i = 0;
+  double t0 = 0.0;
+  double t_bsearch = 0.0;
+  double t_index = 0.0;
+  funcs = (xpl_func_info_t*)calloc(_n + 1, sizeof(xpl_func_info_t));
+  sorted = (xpl_func_info_t*)calloc(_n + 1, sizeof(xpl_func_info_t));
+  names = (char*)malloc(_n * 32);
+  keys = (const char**)malloc(BENCH_LOOKUPS * sizeof(const char*));
+  for(i = 0; i < _n; i++) {
+    sprintf(names + i * 32, "host_func_%d_%u", i, _bench_rand(&r));
+    funcs[i].name = names + i * 32;
+    funcs[i].func = _bench_nop;
+  }
+  memcpy(sorted, funcs, (_n + 1) * sizeof(xpl_func_info_t));
+  qsort(sorted, _n, sizeof(xpl_func_info_t), _bench_sort_cmp);
+  xpl_open(&xpl, funcs, NULL);
+  for(i = 0; i < BENCH_LOOKUPS; i++)
+    keys[i] = names + (_bench_rand(&r) % _n) * 32;
+
+  t0 = _bench_now();
+  for(i = 0; i < BENCH_LOOKUPS; i++) {
+    f = (xpl_func_info_t*)bsearch(keys[i], sorted, _n, sizeof(xpl_func_info_t), _bench_search_cmp);
+    hits += f != NULL;
+  }
+  t_bsearch = _bench_now() - t0;
+
+  t0 = _bench_now();
+  for(i = 0; i < BENCH_LOOKUPS; i++) {
+    f = _xpl_find_func(&xpl, keys[i]);
+    hits += f != NULL;
+  }
+  t_index = _bench_now() - t0;
+
+  printf("dispatch %7d funcs: bsearch %7.1f ns, index %7.1f ns, speedup %5.2fx%s\n",
+    _n,
+    t_bsearch * 1e9 / BENCH_LOOKUPS,
+    t_index * 1e9 / BENCH_LOOKUPS,
+    t_index > 0.0 ? t_bsearch / t_index : 0.0,
+    hits == 2L * BENCH_LOOKUPS ? "" : " (MISSED)");
+
+  xpl_close(&xpl);
+  free(keys);
+  free(names);
+  free(sorted);
+  free(funcs);
+}
+
+static void bench_number(const char* _t) {
+  char buf[32];
+  char* conv_suc = NULL;
+  double f = 0.0;
+  double sum0 = 0.0;
+  double sum1 = 0.0;
+  int i = 0;
+  double t0 = 0.0;
+  double t_strtod = 0.0;
+  double t_inplace = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+  XPL_FUNC_END
+  xpl_open(&xpl, funcs, NULL);
+
+  t0 = _bench_now();
+  for(i = 0; i < BENCH_LOOKUPS; i++) {
+    xpl_load(&xpl, _t);
+    xpl_pop_string(&xpl, buf, sizeof(buf));
+    sum0 += strtod(buf, &conv_suc);
+  }
+  t_strtod = _bench_now() - t0;
+
+  t0 = _bench_now();
+  for(i = 0; i < BENCH_LOOKUPS; i++) {
+    xpl_load(&xpl, _t);
+    xpl_pop_double(&xpl, &f);
+    sum1 += f;
+  }
+  t_inplace = _bench_now() - t0;
+
+  printf("number %-12s: strtod %7.1f ns, in place %7.1f ns, speedup %5.2fx%s\n",
+    _t,
+    t_strtod * 1e9 / BENCH_LOOKUPS,
+    t_inplace * 1e9 / BENCH_LOOKUPS,
+    t_inplace > 0.0 ? t_strtod / t_inplace : 0.0,
+    sum0 == sum1 ? "" : " (MISMATCH)");
+
+  xpl_close(&xpl);
+}
+
+static void bench_open(int _n) {
+  xpl_func_info_t* funcs = NULL;
+  char* names = NULL;
+  xpl_registry_t registry;
+  unsigned r = 1;
+  int i = 0;
+  int k = 0;
+  int rounds = 0;
+  double t0 = 0.0;
+  double t_open = 0.0;
+  double t_registry = 0.0;
+  funcs = (xpl_func_info_t*)calloc(_n + 1, sizeof(xpl_func_info_t));
+  names = (char*)malloc(_n * 32);
+  for(i = 0; i < _n; i++) {
+    sprintf(names + i * 32, "host_func_%d_%u", i, _bench_rand(&r));
+    funcs[i].name = names + i * 32;
+    funcs[i].func = _bench_nop;
+  }
+  rounds = 2000000 / (_n + 16);
+
+  t0 = _bench_now();
+  for(k = 0; k < rounds; k++) {
+    xpl_open(&xpl, funcs, NULL);
+    xpl_close(&xpl);
+  }
+  t_open = _bench_now() - t0;
+
+  xpl_registry_build(&registry, funcs);
+  t0 = _bench_now();
+  for(k = 0; k < rounds; k++) {
+    xpl_open_registry(&xpl, &registry, NULL);
+    xpl_close(&xpl);
+  }
+  t_registry = _bench_now() - t0;
+
+  printf("open %7d funcs: array %9.1f ns, registry %7.1f ns, speedup %7.2fx\n",
+    _n,
+    t_open * 1e9 / rounds,
+    t_registry * 1e9 / rounds,
+    t_registry > 0.0 ? t_open / t_registry : 0.0);
+
+  free(names);
+  free(funcs);
+}
+
+#define BENCH_RECORDS 64
+
+static long records[BENCH_RECORDS];
+
+static long hits;
+
+static xpl_status_t _bench_even(xpl_context_t* _s) {
+  xpl_lanes_t lanes = 0;
+  xpl_lanes_t m = 0;
+  int i = 0;
+  xpl_active_lanes(_s, &lanes);
+  for(i = 0; i < BENCH_RECORDS && (lanes >> i); i++) {
+    if(((lanes >> i) & 1) && !(records[i + (int)(long)_s->userdata] & 1))
+      m |= (xpl_lanes_t)1 << i;
+  }
+
+  return xpl_push_lanes(_s, m);
+}
+
+static xpl_status_t _bench_hit(xpl_context_t* _s) {
+  xpl_lanes_t lanes = 0;
+  xpl_active_lanes(_s, &lanes);
+  for(; lanes; lanes &= lanes - 1) hits++;
+
+  return XS_OK;
+}
+
+static void bench_batch(void) {
+  static const char* script = "if even then hit elseif even or even then hit hit else hit endif";
+  xpl_registry_t registry;
+  long expect = 0;
+  int i = 0;
+  int k = 0;
+  int rounds = BENCH_LOOKUPS / BENCH_RECORDS;
+  double t0 = 0.0;
+  double t_record = 0.0;
+  double t_batch = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("even", _bench_even)
+    XPL_FUNC_ADD("hit", _bench_hit)
+  XPL_FUNC_END
+  for(i = 0; i < BENCH_RECORDS; i++)
+    records[i] = i * 7;
+  xpl_registry_build(&registry, funcs);
+  xpl_open_registry(&xpl, &registry, NULL);
+
+  hits = 0;
+  t0 = _bench_now();
+  for(k = 0; k < rounds; k++) {
+    for(i = 0; i < BENCH_RECORDS; i++) {
+      xpl.userdata = (void*)(long)i;
+      xpl_load(&xpl, script);
+      xpl_run(&xpl);
+    }
+  }
+  t_record = _bench_now() - t0;
+  expect = hits;
+
+  hits = 0;
+  xpl.userdata = NULL;
+  t0 = _bench_now();
+  for(k = 0; k < rounds; k++) {
+    xpl_load(&xpl, script);
+    xpl_set_lanes(&xpl, BENCH_RECORDS);
+    xpl_run(&xpl);
+  }
+  t_batch = _bench_now() - t0;
+
+  printf("batch %d records: per record %7.1f ns, batch %7.1f ns, speedup %5.2fx%s\n",
+    BENCH_RECORDS,
+    t_record * 1e9 / (rounds * BENCH_RECORDS),
+    t_batch * 1e9 / (rounds * BENCH_RECORDS),
+    t_batch > 0.0 ? t_record / t_batch : 0.0,
+    hits == expect ? "" : " (MISMATCH)");
+
+  xpl_close(&xpl);
+}
+
+#define BENCH_FIBERS 4096
+
+static xpl_context_t fibers[BENCH_FIBERS];
+
+static xpl_context_t* scheduled[BENCH_FIBERS];
+
+static void bench_scheduler(int _n) {
+  static const char* script = "if true then nop yield if true then nop yield nop endif yield endif nop";
+  xpl_registry_t registry;
+  xpl_scheduler_t scheduler;
+  int i = 0;
+  double t0 = 0.0;
+  double t = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("true", _bench_true)
+    XPL_FUNC_ADD("nop", _bench_nop)
+  XPL_FUNC_END
+  xpl_registry_build(&registry, funcs);
+  xpl_scheduler_open(&scheduler, scheduled, _n, NULL);
+  for(i = 0; i < _n; i++)
+    xpl_open_registry(&fibers[i], &registry, NULL);
+
+  t0 = _bench_now();
+  for(i = 0; i < _n; i++) {
+    xpl_load(&fibers[i], script);
+    xpl_scheduler_add(&scheduler, &fibers[i]);
+  }
+  xpl_scheduler_run(&scheduler);
+  t = _bench_now() - t0;
+
+  printf("scheduler %5d fibers: %7.1f ns per resume\n",
+    _n,
+    t * 1e9 / (_n * 4.0));
+
+  for(i = 0; i < _n; i++)
+    xpl_close(&fibers[i]);
+}
+
+#define BENCH_SCRIPT_SIZE (1 << 16)
+#define BENCH_TABLE_FUNCS 10000
+#define BENCH_TOLERANCE 0.10
+#define BENCH_SAMPLES 7
+
+typedef struct bench_result_t {
+  const char* name;
+  double ns_per_token;
+  int failed;
+  int checked;
+} bench_result_t;
+
+static char script[BENCH_SCRIPT_SIZE + 256];
+
+static int script_len;
+
+static int script_tokens;
+
+static bench_result_t results[8];
+
+static int results_count;
+
+static volatile size_t sink;
+
+static xpl_status_t _bench_false(xpl_context_t* _s) {
+  return xpl_push_bool(_s, 0);
+}
+
+static xpl_status_t _bench_params(xpl_context_t* _s) {
+  while(xpl_has_param(_s) == XS_OK)
+    xpl_skip_string(_s);
+
+  return XS_OK;
+}
+
+static xpl_status_t _bench_strings(xpl_context_t* _s) {
+  char buf[256];
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_string(_s, buf, sizeof(buf)) != XS_OK) return XS_PARAM_TYPE_ERROR;
+    sink += buf[0];
+  }
+
+  return XS_OK;
+}
+
+static int _bench_is_escape(unsigned char _c) {
+  return _c == '\\';
+}
+
+static int _bench_parse_escape(char** _d, const char** _s) {
+  ++*_s;
+  switch(*(*_s)++) {
+    case 'n': *(*_d)++ = '\n'; return 1;
+    case 't': *(*_d)++ = '\t'; return 1;
+    case '"': *(*_d)++ = '"'; return 1;
+    case '\\': *(*_d)++ = '\\'; return 1;
+    default: return 0;
+  }
+}
+
+static void _bench_emit(const char* _t, int _tokens) {
+  int l = (int)strlen(_t);
+  memcpy(script + script_len, _t, l + 1);
+  script_len += l;
+  script_tokens += _tokens;
+}
+
+static void _bench_gen_nested(void) {
+  int i = 0;
+  while(script_len < BENCH_SCRIPT_SIZE - 1024) {
+    for(i = 0; i < 32; i++) _bench_emit("if t then ", 3);
+    _bench_emit("p 1 2 ", 3);
+    for(i = 0; i < 32; i++) _bench_emit("endif ", 1);
+  }
+}
+
+static void _bench_gen_untaken(void) {
+  int i = 0;
+  while(script_len < BENCH_SCRIPT_SIZE - 2048) {
+    _bench_emit("if f then ", 3);
+    for(i = 0; i < 64; i++) _bench_emit("p 12 \"ab\" 3.5 ", 4);
+    _bench_emit("else p endif ", 3);
+  }
+}
+
+static void _bench_gen_table(void) {
+  char buf[32];
+  unsigned r = 1;
+  while(script_len < BENCH_SCRIPT_SIZE - 64) {
+    sprintf(buf, "fn_%u 1 ", _bench_rand(&r) % BENCH_TABLE_FUNCS);
+    _bench_emit(buf, 2);
+  }
+}
+
+static void _bench_gen_strings(void) {
+  while(script_len < BENCH_SCRIPT_SIZE - 256)
+    _bench_emit("s \"a long quoted string with \\\"escapes\\\",\\tsome tabs\\nand lines\" \"plain string without any escape at all\" ", 3);
+}
+
+static void _bench_gen_comments(void) {
+  while(script_len < BENCH_SCRIPT_SIZE - 256)
+    _bench_emit("'a comment which is much longer than the statement it describes' p 1 'and another one' ", 2);
+}
+
+static void _bench_workload(const char* _n, void (* _gen)(void), const xpl_registry_t* _r) {
+  const char* volatile text = script;
+  int rounds = 0;
+  int i = 0;
+  int k = 0;
+  xpl_status_t ret = XS_OK;
+  double t0 = 0.0;
+  double t = 0.0;
+  double t_run = 0.0;
+  double t_strlen = 0.0;
+  script_len = script_tokens = 0;
+  script[0] = '\0';
+  _gen();
+  xpl_open_registry(&xpl, _r, NULL);
+  xpl.escape_detect = _bench_is_escape;
+  xpl.escape_parse = _bench_parse_escape;
+
+  /* Sizes a sample to about 30ms, then keeps the fastest of the samples. */
+  t0 = _bench_wall();
+  do {
+    xpl_load(&xpl, script);
+    ret = xpl_run(&xpl);
+    rounds++;
+  } while((t_run = _bench_wall() - t0) < 0.03);
+  for(i = 0; i < BENCH_SAMPLES && ret == XS_OK; i++) {
+    t0 = _bench_wall();
+    for(k = 0; k < rounds && ret == XS_OK; k++) {
+      xpl_load(&xpl, script);
+      ret = xpl_run(&xpl);
+    }
+    t = _bench_wall() - t0;
+    if(t < t_run) t_run = t;
+  }
+
+  t_strlen = -1.0;
+  for(i = 0; i < BENCH_SAMPLES; i++) {
+    t0 = _bench_wall();
+    for(k = 0; k < rounds; k++)
+      sink += strlen(text);
+    t = _bench_wall() - t0;
+    if(t_strlen < 0.0 || t < t_strlen) t_strlen = t;
+  }
+
+  printf("%-10s: %7.2f ns/token, %8.1f MB/s, %6.2fx strlen%s\n",
+    _n,
+    t_run * 1e9 / ((double)rounds * script_tokens),
+    (double)rounds * script_len / t_run / 1e6,
+    t_strlen > 0.0 ? t_run / t_strlen : 0.0,
+    ret == XS_OK ? "" : " (FAILED)");
+  results[results_count].name = _n;
+  results[results_count].ns_per_token = t_run * 1e9 / ((double)rounds * script_tokens);
+  results[results_count].failed = ret != XS_OK;
+  results[results_count].checked = 0;
+  results_count++;
+
+  xpl_close(&xpl);
+}
+
+static void bench_suite(void) {
+  xpl_func_info_t* table = NULL;
+  char* names = NULL;
+  xpl_registry_t registry;
+  int i = 0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("t", _bench_true)
+    XPL_FUNC_ADD("f", _bench_false)
+    XPL_FUNC_ADD("p", _bench_params)
+    XPL_FUNC_ADD("s", _bench_strings)
+  XPL_FUNC_END
+  results_count = 0;
+  xpl_registry_build(&registry, funcs);
+  _bench_workload("nested", _bench_gen_nested, &registry);
+  _bench_workload("untaken", _bench_gen_untaken, &registry);
+  _bench_workload("strings", _bench_gen_strings, &registry);
+  _bench_workload("comments", _bench_gen_comments, &registry);
+
+  table = (xpl_func_info_t*)calloc(BENCH_TABLE_FUNCS + 1, sizeof(xpl_func_info_t));
+  names = (char*)malloc(BENCH_TABLE_FUNCS * 16);
+  for(i = 0; i < BENCH_TABLE_FUNCS; i++) {
+    sprintf(names + i * 16, "fn_%d", i);
+    table[i].name = names + i * 16;
+    table[i].func = _bench_params;
+  }
+  xpl_registry_build(&registry, table);
+  _bench_workload("table", _bench_gen_table, &registry);
+  free(names);
+  free(table);
+}
+
+static int bench_save(const char* _p) {
+  FILE* fp = NULL;
+  int i = 0;
+  for(i = 0; i < results_count; i++) {
+    if(results[i].failed) { printf("can't save baseline, %s FAILED\n", results[i].name); return 1; }
+  }
+  fp = fopen(_p, "w");
+  if(!fp) { printf("can't write baseline %s\n", _p); return 1; }
+  for(i = 0; i < results_count; i++)
+    fprintf(fp, "%s %f\n", results[i].name, results[i].ns_per_token);
+  fclose(fp);
+
+  return 0;
+}
+
+static int bench_check(const char* _p, double _t) {
+  FILE* fp = fopen(_p, "r");
+  char name[32];
+  double base = 0.0;
+  int bad = 0;
+  int i = 0;
+  if(!fp) { printf("can't read baseline %s\n", _p); return 1; }
+  while(fscanf(fp, "%31s %lf", name, &base) == 2) {
+    for(i = 0; i < results_count && strcmp(results[i].name, name); i++) { }
+    if(i == results_count) {
+      printf("MISSING    %-10s: in baseline, not measured\n", name);
+      bad++;
+      continue;
+    }
+    results[i].checked = 1;
+    if(results[i].failed) {
+      printf("FAILED     %-10s\n", name);
+      bad++;
+    } else if(results[i].ns_per_token > base * (1.0 + _t)) {
+      printf("REGRESSION %-10s: %7.2f ns/token, baseline %7.2f\n", name, results[i].ns_per_token, base);
+      bad++;
+    }
+  }
+  fclose(fp);
+  for(i = 0; i < results_count; i++) {
+    if(results[i].checked) continue;
+    printf("MISSING    %-10s: measured, not in baseline\n", results[i].name);
+    bad++;
+  }
+  printf("%d failure(s), tolerance %.0f%%, fastest of %d samples\n", bad, _t * 100, BENCH_SAMPLES);
+
+  return bad ? 1 : 0;
+}
+
+#define BENCH_PAYLOAD_SIZE (1 << 20)
+
+static char payload[BENCH_PAYLOAD_SIZE + 64];
+
+static char decoded[BENCH_PAYLOAD_SIZE + 64];
+
+static xpl_status_t _bench_payload(xpl_context_t* _s) {
+  xpl_status_t ret = xpl_pop_string(_s, decoded, sizeof(decoded));
+  sink += decoded[0];
+
+  return ret;
+}
+
+static double _bench_escape_run(int _n) {
+  int rounds = 0;
+  xpl_status_t ret = XS_OK;
+  double t0 = 0.0;
+  double t = 0.0;
+  t0 = _bench_now();
+  do {
+    xpl_load_n(&xpl, payload, _n);
+    ret = xpl_run(&xpl);
+    rounds++;
+  } while((t = _bench_now() - t0) < 0.2);
+
+  return ret == XS_OK ? (double)rounds * _n / t / 1e6 : 0.0;
+}
+
+static void bench_escape(int _n) {
+  static const char* pieces[] = { "{\\\"key\\\": ", "\\\"value\\\", ", "\\n", "caf\\u00e9 " };
+  int n = 0;
+  int i = 0;
+  double hooks = 0.0;
+  double builtin = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("s", _bench_payload)
+  XPL_FUNC_END
+  n = sprintf(payload, "s \"");
+  while(n < _n - 64) {
+    for(i = 0; i < 48 && n < _n - 64; i++) payload[n++] = (char)('a' + i % 26);
+    n += sprintf(payload + n, "%s", pieces[(n / 48) % _countof(pieces)]);
+  }
+  n += sprintf(payload + n, "\"");
+  xpl_open(&xpl, funcs, NULL);
+  xpl.escape_detect = _bench_is_escape;
+  xpl.escape_parse = xpl_parse_escape;
+  hooks = _bench_escape_run(n);
+  xpl.escape_detect = xpl_is_backslash;
+  xpl.escape_parse = xpl_parse_escape;
+  builtin = _bench_escape_run(n);
+
+  printf("escape %7d bytes: hooks %8.1f MB/s, buildin %8.1f MB/s, speedup %5.2fx%s\n",
+    n, hooks, builtin, hooks > 0.0 ? builtin / hooks : 0.0,
+    hooks > 0.0 && builtin > 0.0 ? "" : " (FAILED)");
+
+  xpl_close(&xpl);
+}
+
+#define BENCH_IMAGE_INSTRS (1 << 15)
+
+static xpl_instr_t image_code[BENCH_IMAGE_INSTRS];
+
+static int image[(sizeof(xpl_image_header_t) + sizeof(image_code)) / sizeof(int)];
+
+static void bench_image(void) {
+  xpl_registry_t registry;
+  xpl_program_t prog;
+  FILE* fp = NULL;
+  size_t size = 0;
+  int rounds = 0;
+  int k = 0;
+  xpl_status_t ret = XS_OK;
+  double t0 = 0.0;
+  double t_compile = 0.0;
+  double t_image = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("t", _bench_true)
+    XPL_FUNC_ADD("f", _bench_false)
+    XPL_FUNC_ADD("p", _bench_params)
+  XPL_FUNC_END
+  script_len = script_tokens = 0;
+  script[0] = '\0';
+  _bench_gen_untaken();
+  xpl_registry_build(&registry, funcs);
+  xpl_open_registry(&xpl, &registry, NULL);
+  xpl_load(&xpl, script);
+  if(xpl_compile(&xpl, &prog, image_code, BENCH_IMAGE_INSTRS) != XS_OK || !(fp = tmpfile())) {
+    xpl_close(&xpl);
+
+    return;
+  }
+  xpl_image_save(&xpl, fp);
+  size = (size_t)ftell(fp);
+  rewind(fp);
+  size = fread(image, 1, size, fp);
+  fclose(fp);
+
+  t0 = _bench_now();
+  do {
+    xpl_load(&xpl, script);
+    xpl_compile(&xpl, &prog, image_code, BENCH_IMAGE_INSTRS);
+    rounds++;
+  } while((t_compile = _bench_now() - t0) < 0.2);
+
+  t0 = _bench_now();
+  for(k = 0; k < rounds; k++) {
+    xpl_load(&xpl, script);
+    ret = xpl_image_load(&xpl, &prog, image, size);
+  }
+  t_image = _bench_now() - t0;
+
+  printf("image %d KB, %d instrs: compile %8.1f us, image %8.1f us, speedup %6.2fx%s\n",
+    script_len / 1024, prog.instrs_count,
+    t_compile * 1e6 / rounds,
+    t_image * 1e6 / rounds,
+    t_image > 0.0 ? t_compile / t_image : 0.0,
+    ret == XS_OK ? "" : " (MISMATCH)");
+
+  xpl_close(&xpl);
+}
+
+static xpl_literal_t literals[BENCH_IMAGE_INSTRS * 4];
+
+static xpl_status_t _bench_numbers(xpl_context_t* _s) {
+  double d = 0.0;
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_double(_s, &d) != XS_OK) return XS_PARAM_TYPE_ERROR;
+    sink += (size_t)d;
+  }
+
+  return XS_OK;
+}
+
+static double _bench_literals_run(void) {
+  int rounds = 0;
+  xpl_status_t ret = XS_OK;
+  double t0 = 0.0;
+  double t = 0.0;
+  t0 = _bench_now();
+  do {
+    xpl_reload(&xpl);
+    ret = xpl_run_compiled(&xpl);
+    rounds++;
+  } while((t = _bench_now() - t0) < 0.2);
+
+  return ret == XS_OK ? t * 1e9 / ((double)rounds * script_tokens) : 0.0;
+}
+
+static void bench_literals(void) {
+  xpl_program_t prog;
+  double plain = 0.0;
+  double cached = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("n", _bench_numbers)
+  XPL_FUNC_END
+  script_len = script_tokens = 0;
+  script[0] = '\0';
+  while(script_len < BENCH_SCRIPT_SIZE - 64)
+    _bench_emit("n 3.14 42 -0.000125 6.02214e23 \"1024\" ", 6);
+  xpl_open(&xpl, funcs, NULL);
+  xpl_load(&xpl, script);
+  xpl_compile(&xpl, &prog, image_code, BENCH_IMAGE_INSTRS);
+  plain = _bench_literals_run();
+  xpl_compile_literals(&xpl, &prog, image_code, BENCH_IMAGE_INSTRS, literals, _countof(literals));
+  cached = _bench_literals_run();
+
+  printf("literals  : parsed %7.2f ns/token, cached %7.2f ns/token, speedup %5.2fx%s\n",
+    plain, cached, cached > 0.0 ? plain / cached : 0.0,
+    plain > 0.0 && cached > 0.0 ? "" : " (FAILED)");
+
+  xpl_close(&xpl);
+}
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+static void bench_script_cache(void) {
+  xpl_script_cache_t cache;
+  xpl_script_cache_stats_t stats;
+  xpl_program_t prog;
+  int rounds = 0;
+  int k = 0;
+  double t0 = 0.0;
+  double t_compile = 0.0;
+  double t_cached = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("t", _bench_true)
+    XPL_FUNC_ADD("f", _bench_false)
+    XPL_FUNC_ADD("p", _bench_params)
+  XPL_FUNC_END
+  script_len = script_tokens = 0;
+  script[0] = '\0';
+  _bench_gen_untaken();
+  xpl_open(&xpl, funcs, NULL);
+  xpl_script_cache_open(&cache, 1 << 24);
+
+  t0 = _bench_now();
+  do {
+    xpl_load(&xpl, script);
+    xpl_compile_literals(&xpl, &prog, image_code, BENCH_IMAGE_INSTRS, literals, _countof(literals));
+    rounds++;
+  } while((t_compile = _bench_now() - t0) < 0.2);
+
+  t0 = _bench_now();
+  for(k = 0; k < rounds; k++)
+    xpl_load_cached(&xpl, &cache, script, script_len);
+  t_cached = _bench_now() - t0;
+
+  xpl_unload(&xpl);
+  xpl_script_cache_stats(&cache, &stats);
+  printf("cache %d KB: compile %8.1f us, cached %8.1f us, speedup %6.2fx, hits %d misses %d\n",
+    script_len / 1024,
+    t_compile * 1e6 / rounds,
+    t_cached * 1e6 / rounds,
+    t_cached > 0.0 ? t_compile / t_cached : 0.0,
+    (int)stats.hits, (int)stats.misses);
+
+  xpl_script_cache_close(&cache);
+  xpl_close(&xpl);
+}
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+#ifdef XPL_ENABLE_POOL
+#define BENCH_JOBS 200000
+
+static xpl_status_t _bench_sum(xpl_context_t* _s) {
+  long v = 0;
+  long* acc = (long*)_s->userdata;
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_long(_s, &v) != XS_OK) return XS_PARAM_TYPE_ERROR;
+    *acc += v;
+  }
+  xpl_push_bool(_s, (int)(*acc & 1));
+
+  return XS_OK;
+}
+
+static xpl_job_t jobs[BENCH_JOBS];
+
+static long sums[BENCH_JOBS];
+
+static xpl_worker_t workers[64];
+
+static void bench_pool(int _n) {
+  static const char* script = "sum 1 2 3 4 5 if sum 1 then sum 10 20 elseif sum 0 then sum 30 else sum 40 endif";
+  xpl_pool_t pool;
+  long expect = 0;
+  int i = 0;
+  int bad = 0;
+  double t0 = 0.0;
+  double t = 0.0;
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("sum", _bench_sum)
+  XPL_FUNC_END
+  xpl_open(&xpl, funcs, NULL);
+  xpl_pool_open(&pool, &xpl, workers, _n, 1, NULL);
+  for(i = 0; i < BENCH_JOBS; i++) {
+    sums[i] = 0;
+    jobs[i].text = script;
+    jobs[i].length = strlen(script);
+    jobs[i].userdata = &sums[i];
+  }
+
+  t0 = _bench_wall();
+  for(i = 0; i < BENCH_JOBS; i++)
+    xpl_pool_submit(&pool, &jobs[i]);
+  xpl_pool_wait(&pool);
+  t = _bench_wall() - t0;
+
+  expect = 15 + 1 + 40;
+  for(i = 0; i < BENCH_JOBS; i++)
+    bad += sums[i] != expect || jobs[i].status != XS_OK;
+  printf("pool %2d workers: %9.0f jobs/s%s\n",
+    _n,
+    t > 0.0 ? BENCH_JOBS / t : 0.0,
+    bad ? " (WRONG)" : "");
+
+  xpl_pool_close(&pool);
+  xpl_close(&xpl);
+}
+#endif /* XPL_ENABLE_POOL */
+
+int main(int argc, char* argv[]) {
+  if(argc >= 3 && !strcmp(argv[1], "--save")) {
+    bench_suite();
+
+    return bench_save(argv[2]);
+  } else if(argc >= 3 && !strcmp(argv[1], "--check")) {
+    bench_suite();
+
+    return bench_check(argv[2], argc >= 4 ? atof(argv[3]) / 100 : BENCH_TOLERANCE);
+  }
+  bench_suite();
+  bench_dispatch(10);
+  bench_dispatch(100);
+  bench_dispatch(1000);
+  bench_dispatch(10000);
+  bench_dispatch(100000);
+  bench_open(10);
+  bench_open(1000);
+  bench_open(100000);
+  bench_number("42");
+  bench_number("3.14");
+  bench_number("-0.000125");
+  bench_number("6.02214e23");
+  bench_batch();
+  bench_scheduler(64);
+  bench_scheduler(BENCH_FIBERS);
+  bench_image();
+  bench_literals();
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+  bench_script_cache();
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+  bench_escape(1 << 10);
+  bench_escape(1 << 14);
+  bench_escape(1 << 18);
+  bench_escape(BENCH_PAYLOAD_SIZE);
+#ifdef XPL_ENABLE_POOL
+  bench_pool(1);
+  bench_pool(2);
+  bench_pool(4);
+  bench_pool(8);
+#endif /* XPL_ENABLE_POOL */
+
+  return 0;
+}
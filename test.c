@@ -11,7 +11,11 @@
  * http://sam.zoy.org/wtfpl/COPYING for more details.
  */
 
-#include "xpl.h"
+#if defined(__cplusplus) && __cplusplus >= 201703L
+#  include "xpl.hpp"
+#else /* __cplusplus */
+#  include "xpl.h"
+#endif /* __cplusplus */
 
 static int _xpl_is_rsolidus(unsigned char _c) {
   return _c == '\\';
@@ -53,11 +57,22 @@ static int _xpl_parse_escape(char** _d, const char** _s) {
   return ret;
 }
 
+static int _xpl_read_chunk(void* _u, char* _b, int _l) {
+  const char** src = (const char**)_u;
+  int n = (int)strlen(*src);
+  if(n > 7) n = 7;
+  if(n > _l) n = _l;
+  memcpy(_b, *src, n);
+  *src += n;
+
+  return n;
+}
+
 static xpl_status_t test1(xpl_context_t* _s) {
   double f = 0.0;
   printf("test1\n");
-  if(xpl_has_param(_s) == XS_OK) {
-    xpl_pop_double(_s, &f);
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_double(_s, &f) != XS_OK) { printf("has_param error\n"); break; }
     printf("has_param %f\n", f);
   }
 
@@ -76,7 +91,35 @@ static xpl_status_t test2(xpl_context_t* _s) {
 }
 
 static xpl_status_t test3(xpl_context_t* _s) {
+  xpl_int64_t v = 0;
   printf("test3\n");
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_int64(_s, &v) != XS_OK) break;
+    printf("has_param %lld\n", (long long)v);
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t test4(xpl_context_t* _s) {
+  char buf[64] = { '\0' };
+  xpl_string_view_t view;
+  printf("test4\n");
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_string_view(_s, &view, buf, 64) != XS_OK) break;
+    printf("has_param %.*s%s\n", (int)view.len, view.ptr, view.ptr == buf ? " (decoded)" : "");
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t test6(xpl_context_t* _s) {
+  xpl_string_view_t view;
+  printf("test6\n");
+  while(xpl_has_param(_s) == XS_OK) {
+    if(xpl_pop_string_scratch(_s, &view) != XS_OK) break;
+    printf("has_param %d chars: %.*s\n", (int)view.len, (int)view.len, view.ptr);
+  }
 
   return XS_OK;
 }
@@ -95,25 +138,257 @@ static xpl_status_t cond2(xpl_context_t* _s) {
   return XS_OK;
 }
 
+static xpl_status_t test5(xpl_context_t* _s) {
+  xpl_lanes_t lanes = 0;
+  xpl_active_lanes(_s, &lanes);
+  printf("test5 lanes %x\n", (unsigned)lanes);
+
+  return XS_OK;
+}
+
+static xpl_status_t cond3(xpl_context_t* _s) {
+  printf("cond3\n");
+  xpl_push_lanes(_s, 0x5);
+
+  return XS_OK;
+}
+
+static xpl_status_t cond4(xpl_context_t* _s) {
+  long v = 0;
+  xpl_pop_long(_s, &v);
+  printf("cond4 %ld\n", v);
+  xpl_push_bool(_s, v > 1);
+
+  return XS_OK;
+}
+
+static xpl_registry_t registry;
+
 static xpl_context_t xpl;
 
+static char window[48];
+
+static char scratch[256];
+
+static xpl_instr_t code[64];
+
+static xpl_literal_t literals[64];
+
+#ifdef XPL_ENABLE_POOL
+static xpl_pool_t pool;
+
+static xpl_worker_t workers[2];
+
+static xpl_job_t jobs[4];
+
+static void _xpl_job_done(xpl_job_t* _j) {
+  printf("job done on worker %d, status %d\n", _j->worker, (int)_j->status);
+}
+#endif /* XPL_ENABLE_POOL */
+
+static xpl_program_t prog;
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+static xpl_script_cache_t script_cache;
+
+static xpl_script_cache_stats_t script_cache_stats;
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+static double image[256];
+
+#ifdef XPL_ENABLE_PROFILER
+static xpl_profile_t profile;
+
+static xpl_prof_func_t prof_funcs[32];
+
+static xpl_prof_branch_t prof_branches[16];
+#endif /* XPL_ENABLE_PROFILER */
+
+#ifdef XPL_ENABLE_TRACE
+static xpl_trace_ring_t trace;
+
+static xpl_trace_event_t trace_events[64];
+#endif /* XPL_ENABLE_TRACE */
+
+static xpl_context_t fibers[3];
+
+static xpl_context_t* scheduled[3];
+
+static xpl_scheduler_t scheduler;
+
+static void _xpl_fiber_done(xpl_context_t* _s, xpl_status_t _r) {
+  printf("fiber %d done, status %d\n", (int)(_s - fibers), (int)_r);
+}
+
 int main() {
+  int i = 0;
+  size_t size = 0;
+  FILE* fp = NULL;
+  const char* stream = "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif 'a comment longer than the window' test3 1 2 3";
+  const char* long_stream = "test3 1 2 3 4 5 6 7 test2 \"a string over half the window\" test3 8 test2 \"a string that never fits in the 48 bytes window\"";
   XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("test6", test6)
+    XPL_FUNC_ADD("test5", test5)
+    XPL_FUNC_ADD("test4", test4)
     XPL_FUNC_ADD("test3", test3)
     XPL_FUNC_ADD("test2", test2)
     XPL_FUNC_ADD("test1", test1)
+    XPL_FUNC_ADD_FLAGS("cond4", cond4, XFF_PURE)
+    XPL_FUNC_ADD("cond3", cond3)
     XPL_FUNC_ADD("cond2", cond2)
     XPL_FUNC_ADD("cond1", cond1)
   XPL_FUNC_END
 
-  xpl_open(&xpl, funcs, NULL);
+  xpl_registry_build(&registry, funcs);
+  xpl_open_registry(&xpl, &registry, NULL);
     xpl.escape_detect = _xpl_is_rsolidus;
     xpl.escape_parse = _xpl_parse_escape;
     xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
     xpl_run(&xpl);
     xpl_load(&xpl, "if cond1 then if cond2 3 then test3 elseif cond2 then test3 endif test3 endif test2 \"hello world\"");
     xpl_run(&xpl);
+    xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
+    xpl_compile(&xpl, &prog, code, _countof(code));
+    xpl_run_compiled(&xpl);
+    xpl_reload(&xpl);
+    xpl_run_compiled(&xpl);
+    xpl_compile_literals(&xpl, &prog, code, _countof(code), literals, _countof(literals));
+    if((fp = tmpfile()) != NULL) {
+      xpl_image_save(&xpl, fp);
+      size = (size_t)ftell(fp);
+      rewind(fp);
+      size = fread(image, 1, size < sizeof(image) ? size : sizeof(image), fp);
+      fclose(fp);
+      xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
+      if(xpl_image_load(&xpl, &prog, image, size) == XS_OK) {
+        printf("image literals %d\n", prog.literals_count);
+        xpl_run_compiled(&xpl);
+      }
+      xpl_load(&xpl, "if cond2 then test3 endif");
+      printf("image mismatch %d\n", (int)(xpl_image_load(&xpl, &prog, image, size) == XS_IMAGE_MISMATCH));
+      xpl_run(&xpl);
+    }
+    xpl_load(&xpl, "if cond1 and cond2 3 then test3 elseif cond2 or cond1 then test3 4 endif");
+    xpl_run(&xpl);
+    xpl_load(&xpl, "if cond4 1 then test3 1 elseif cond4 2 then if cond4 1 or cond4 2 then test3 2 endif endif");
+    xpl_run(&xpl);
+    xpl_reload(&xpl);
+    xpl_run(&xpl);
+    xpl_load(&xpl, "if cond1 then test3 1, else test3 2 endif");
+    xpl_run(&xpl);
+    xpl_compile_literals(&xpl, &prog, code, _countof(code), literals, _countof(literals));
+    xpl_run_compiled(&xpl);
+    xpl_load(&xpl, "if cond2 then test3 1 elseif cond2 then test4 \"endif\" else if cond2 then test3 2 endif endif test3 3");
+    xpl_run(&xpl);
+    xpl_compile_literals(&xpl, &prog, code, _countof(code), literals, _countof(literals));
+    xpl_run_compiled(&xpl);
+    xpl_load(&xpl, "if cond4 3 \"a b\" 4 then test3 5 endif");
+    xpl_run(&xpl);
+    xpl_reload(&xpl);
+    xpl_run(&xpl);
+#ifdef XPL_ENABLE_PROFILER
+    xpl_profile_open(&profile, &registry, prof_funcs, prof_branches, _countof(prof_branches));
+    xpl_profile_attach(&xpl, &profile);
+    xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
+    xpl_run(&xpl);
+    xpl_compile(&xpl, &prog, code, _countof(code));
+    xpl_run_compiled(&xpl);
+    xpl_profile_attach(&xpl, NULL);
+    xpl_profile_dump(&profile, stdout, XPF_CSV);
+    xpl_profile_dump(&profile, stdout, XPF_JSON);
+#endif /* XPL_ENABLE_PROFILER */
+#ifdef XPL_ENABLE_TRACE
+    xpl_trace_open(&trace, trace_events, _countof(trace_events));
+    xpl_trace_attach(&xpl, &trace);
+    xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
+    xpl_run(&xpl);
+    xpl_trace_attach(&xpl, NULL);
+    xpl_trace_export(&trace, &registry, stdout, 1, 0.0);
+#endif /* XPL_ENABLE_TRACE */
+    xpl_load(&xpl, "test3 42 -0x7f 0b1010 9223372036854775807");
+    xpl_run(&xpl);
+    xpl_compile_literals(&xpl, &prog, code, _countof(code), literals, _countof(literals));
+    xpl_run_compiled(&xpl);
+    xpl_load(&xpl, "test3 010 -007 0 test1 010 1e3 -2.5e-3 12345678901234567890.5 1e");
+    xpl_run(&xpl);
+    xpl_compile_literals(&xpl, &prog, code, _countof(code), literals, _countof(literals));
+    xpl_run_compiled(&xpl);
+    xpl_load(&xpl, "test3 1, test3 2");
+    xpl_run(&xpl);
+    xpl_load(&xpl, "test3 3 \t ");
+    printf("trailing blanks status %d\n", (int)xpl_run(&xpl));
+    xpl_load(&xpl, "if cond1 then test4 \"unterminated");
+    printf("unterminated string status %d\n", (int)xpl_run(&xpl));
+    xpl_load_n(&xpl, "test3 1 2 3 test3 4 5 6", 11);
+    xpl_run(&xpl);
+    xpl_load(&xpl, "test4 hello \"hello world\" \"hello \\\"world\\\"\"");
+    xpl_run(&xpl);
+    xpl_compile(&xpl, &prog, code, _countof(code));
+    xpl_run_compiled(&xpl);
+    xpl_set_scratch(&xpl, scratch, sizeof(scratch));
+    xpl_load(&xpl, "test6 \"a \\\"quoted\\\" payload longer than the 64 bytes buffer of test4, decoded into the scratch arena\" short");
+    xpl_run(&xpl);
+    xpl_set_scratch(&xpl, NULL, 0);
+    xpl.escape_detect = xpl_is_backslash;
+    xpl.escape_parse = xpl_parse_escape;
+    xpl_load(&xpl, "test4 \"caf\\u00e9 \\\"bulk\\\"\\tdecoded\\ud83d\\ude00\" \"no escape\"");
+    xpl_run(&xpl);
+    xpl.escape_detect = _xpl_is_rsolidus;
+    xpl.escape_parse = _xpl_parse_escape;
+    xpl_load_stream(&xpl, _xpl_read_chunk, &stream, window, sizeof(window));
+    xpl_run(&xpl);
+    xpl_unload(&xpl);
+    xpl_load_stream(&xpl, _xpl_read_chunk, &long_stream, window, sizeof(window));
+    printf("stream status %d\n", (int)xpl_run(&xpl));
+    xpl_unload(&xpl);
+    xpl_load(&xpl, "if cond2 then test3 1 if cond1 then test3 0 else yield test3 2 endif yield test3 3 endif");
+    while(xpl_run(&xpl) == XS_SUSPENT)
+      printf("yield\n");
+    xpl_unload(&xpl);
+    xpl_load(&xpl, "test3 1 if cond1 then test3 2 'skipped' test3 3 test3 4 elseif cond2 then test3 5 else test3 6 endif test3 7");
+    for(i = 0; xpl_run_budget(&xpl, 2) == XS_PREEMPTED; i++) { }
+    printf("preempted %d\n", i);
+    xpl_compile(&xpl, &prog, code, _countof(code));
+    for(i = 0; xpl_run_budget(&xpl, 2) == XS_PREEMPTED; i++) { }
+    printf("preempted %d\n", i);
+    xpl_unload(&xpl);
+    xpl_load(&xpl, "test5 if cond3 then test5 elseif cond2 then test5 endif test5");
+    xpl_set_lanes(&xpl, 4);
+    xpl_run(&xpl);
+    xpl_compile(&xpl, &prog, code, _countof(code));
+    xpl_run_compiled(&xpl);
+    xpl_set_lanes(&xpl, 1);
     xpl_unload(&xpl);
+    xpl_scheduler_open(&scheduler, scheduled, _countof(scheduled), _xpl_fiber_done);
+    for(i = 0; i < (int)_countof(fibers); i++) {
+      xpl_open_registry(&fibers[i], &registry, NULL);
+      xpl_load(&fibers[i], i ? "test3 1 if cond2 then yield test3 2 endif yield test3 3" : "test3 0");
+      xpl_scheduler_add(&scheduler, &fibers[i]);
+    }
+    xpl_scheduler_run(&scheduler);
+    for(i = 0; i < (int)_countof(fibers); i++)
+      xpl_close(&fibers[i]);
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+    xpl_script_cache_open(&script_cache, 1 << 16);
+    for(i = 0; i < 3; i++) {
+      xpl_load_cached(&xpl, &script_cache, "if cond2 then test3 1 2 endif test1 2.5", 39);
+      xpl_run_compiled(&xpl);
+    }
+    xpl_unload(&xpl);
+    xpl_script_cache_stats(&script_cache, &script_cache_stats);
+    printf("script cache hits %d misses %d entries %d\n", (int)script_cache_stats.hits, (int)script_cache_stats.misses, script_cache_stats.entries);
+    xpl_script_cache_close(&script_cache);
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+#ifdef XPL_ENABLE_POOL
+    xpl_pool_open(&pool, &xpl, workers, _countof(workers), 0, _xpl_job_done);
+    for(i = 0; i < (int)_countof(jobs); i++) {
+      jobs[i].text = "if cond2 then test3 endif";
+      jobs[i].length = strlen(jobs[i].text);
+      xpl_pool_submit(&pool, &jobs[i]);
+    }
+    xpl_pool_wait(&pool);
+    xpl_pool_close(&pool);
+#endif /* XPL_ENABLE_POOL */
   xpl_close(&xpl);
 
   return 0;
@@ -32,6 +32,66 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <limits.h>
+#include <locale.h>
+#if defined(_MSC_VER) && _MSC_VER < 1600
+typedef __int64 xpl_int64_t;
+typedef unsigned __int64 xpl_uint64_t;
+#else /* _MSC_VER && _MSC_VER < 1600 */
+#  include <stdint.h>
+typedef int64_t xpl_int64_t;
+typedef uint64_t xpl_uint64_t;
+#endif /* _MSC_VER && _MSC_VER < 1600 */
+
+/**
+ * @brief Mask of batch lanes, bit i for record i of a batch.
+ */
+typedef xpl_uint64_t xpl_lanes_t;
+
+#ifndef XPL_NO_SIMD
+#  if defined(__AVX2__)
+#    include <immintrin.h>
+#    define XPL_SIMD_AVX2
+#  elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define XPL_SIMD_SSE2
+#  endif
+#endif /* !XPL_NO_SIMD */
+#ifdef _MSC_VER
+#  include <intrin.h>
+#endif /* _MSC_VER */
+#ifndef XPL_NO_MMAP
+#  if defined(_WIN32)
+#    include <windows.h>
+#  elif defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <unistd.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#  else
+#    define XPL_NO_MMAP
+#  endif
+#endif /* !XPL_NO_MMAP */
+#if defined(XPL_ENABLE_POOL) || defined(XPL_ENABLE_SCRIPT_CACHE)
+#  if defined(_WIN32)
+#    include <windows.h>
+#  else
+#    include <pthread.h>
+#    include <sched.h>
+#  endif
+#endif /* XPL_ENABLE_POOL || XPL_ENABLE_SCRIPT_CACHE */
+#if defined(XPL_ENABLE_PROFILER) || defined(XPL_ENABLE_TRACE)
+#  if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <windows.h>
+#    define XPL_TICKS_RDTSC
+#  elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    include <x86intrin.h>
+#    define XPL_TICKS_RDTSC
+#  elif defined(_WIN32)
+#    include <windows.h>
+#  endif
+#  include <time.h>
+#endif /* XPL_ENABLE_PROFILER || XPL_ENABLE_TRACE */
 
 #ifdef __cplusplus
 extern "C" {
@@ -81,20 +141,23 @@ extern "C" {
 /**< Begins an interface declaration with buildin interfaces. */
 #  define XPL_FUNC_BEGIN(a) \
     static xpl_func_info_t a[] = { \
-      { "if", _xpl_core_if }, \
-      { "then", _xpl_core_then }, \
-      { "elseif", _xpl_core_elseif }, \
-      { "else", _xpl_core_else }, \
-      { "endif", _xpl_core_endif }, \
-      { "or", _xpl_core_or }, \
-      { "and", _xpl_core_and }, \
-      { "yield", _xpl_core_yield },
+      { "if", _xpl_core_if, 0, 0, 0, "_xpl_core_if" }, \
+      { "then", _xpl_core_then, 0, 0, 0, "_xpl_core_then" }, \
+      { "elseif", _xpl_core_elseif, 0, 0, 0, "_xpl_core_elseif" }, \
+      { "else", _xpl_core_else, 0, 0, 0, "_xpl_core_else" }, \
+      { "endif", _xpl_core_endif, 0, 0, 0, "_xpl_core_endif" }, \
+      { "or", _xpl_core_or, 0, 0, 0, "_xpl_core_or" }, \
+      { "and", _xpl_core_and, 0, 0, 0, "_xpl_core_and" }, \
+      { "yield", _xpl_core_yield, 0, 0, 0, "_xpl_core_yield" },
 /**< Declares an interface. */
 #  define XPL_FUNC_ADD(n, f) \
-      { n, f },
+      { n, f, 0, 0, 0, #f },
+/**< Declares an interface with flags of xpl_func_flags_t. */
+#  define XPL_FUNC_ADD_FLAGS(n, f, g) \
+      { n, f, g, 0, 0, #f },
 /**< Ends an interface declaration. */
 #  define XPL_FUNC_END \
-      { NULL, NULL }, \
+      { NULL, NULL, 0, 0, 0, NULL }, \
     };
 #endif /* !XPL_FUNC_REGISTER */
 
@@ -104,17 +167,171 @@ extern "C" {
 #ifndef XPL_SKIP_MEANINGLESS
 #  define XPL_SKIP_MEANINGLESS(s) \
     do { \
-      while(_xpl_is_squote(*(unsigned char*)(s)->cursor) || _xpl_is_blank(*(unsigned char*)(s)->cursor)) { \
-        _xpl_trim(&(s)->cursor); if(xpl_skip_comment(s) == XS_OK) _xpl_trim(&(s)->cursor); } \
+      while((s)->cursor < (s)->text_end && (s)->char_class[*(unsigned char*)(s)->cursor] & (XCC_BLANK | XCC_SQUOTE)) { \
+        (s)->cursor = _xpl_skip_blank((s)->cursor, (s)->text_end); \
+        if(xpl_skip_comment(s) == XS_OK) (s)->cursor = _xpl_skip_blank((s)->cursor, (s)->text_end); } \
     } while(0)
 #endif /* !XPL_SKIP_MEANINGLESS */
 
 /**
- * @brief Avoids function folding optimization during compiling time.
+ * @brief Emits a trace event if a trace ring is attached, expands to nothing
+ *  if tracing is compiled out.
+ */
+#ifdef XPL_ENABLE_TRACE
+#  define _XPL_TRACE(s, k, f, o, r) do { if((s)->trace) _xpl_trace_emit((s), (k), (f), (o), (r)); } while(0)
+#else /* XPL_ENABLE_TRACE */
+#  define _XPL_TRACE(s, k, f, o, r) do { } while(0)
+#endif /* XPL_ENABLE_TRACE */
+
+/**
+ * @brief Atomic helpers of the trace ring.
+ */
+#ifdef XPL_ENABLE_TRACE
+#  if defined(__GNUC__) || defined(__clang__)
+#    define _XPL_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#    define _XPL_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#  else
+#    define _XPL_LOAD_ACQUIRE(p) (*(volatile unsigned*)(p))
+#    define _XPL_STORE_RELEASE(p, v) (*(volatile unsigned*)(p) = (v))
+#  endif
+#endif /* XPL_ENABLE_TRACE */
+
+/**
+ * @brief Vector helpers of the bulk scanning kernels, the kernels only do
+ *  aligned loads so they never read across a page boundary, hits beyond the
+ *  end of text are dropped.
+ */
+#if defined(XPL_SIMD_AVX2)
+#  define XPL_VEC_SIZE 32
+#  define XPL_VEC_FULL 0xffffffffu
+#  define _XPL_VEC __m256i
+#  define _XPL_VLOAD(p) _mm256_load_si256((const __m256i*)(p))
+#  define _XPL_VSET(c) _mm256_set1_epi8((char)(c))
+#  define _XPL_VEQ(a, b) _mm256_cmpeq_epi8((a), (b))
+#  define _XPL_VOR(a, b) _mm256_or_si256((a), (b))
+#  define _XPL_VMASK(a) ((unsigned)_mm256_movemask_epi8(a))
+#elif defined(XPL_SIMD_SSE2)
+#  define XPL_VEC_SIZE 16
+#  define XPL_VEC_FULL 0xffffu
+#  define _XPL_VEC __m128i
+#  define _XPL_VLOAD(p) _mm_load_si128((const __m128i*)(p))
+#  define _XPL_VSET(c) _mm_set1_epi8((char)(c))
+#  define _XPL_VEQ(a, b) _mm_cmpeq_epi8((a), (b))
+#  define _XPL_VOR(a, b) _mm_or_si128((a), (b))
+#  define _XPL_VMASK(a) ((unsigned)_mm_movemask_epi8(a))
+#endif
+
+/**
+ * @brief Keeps address sanitizers off the bulk scanning kernels, which may
+ *  read the rest of an aligned block after a terminator.
+ */
+#ifndef XPL_NO_SANITIZE
+#  if defined(__GNUC__) || defined(__clang__)
+#    define XPL_NO_SANITIZE __attribute__((no_sanitize_address))
+#  else
+#    define XPL_NO_SANITIZE
+#  endif
+#endif /* !XPL_NO_SANITIZE */
+
+/**
+ * @brief Thread helpers of the worker pool and the script cache.
+ */
+#if defined(XPL_ENABLE_POOL) || defined(XPL_ENABLE_SCRIPT_CACHE)
+#  if defined(_WIN32)
+#    define _XPL_THREAD HANDLE
+#    define _XPL_MUTEX CRITICAL_SECTION
+#    define _XPL_COND CONDITION_VARIABLE
+#    define _XPL_MUTEX_INIT(m) InitializeCriticalSection(m)
+#    define _XPL_MUTEX_FREE(m) DeleteCriticalSection(m)
+#    define _XPL_LOCK(m) EnterCriticalSection(m)
+#    define _XPL_UNLOCK(m) LeaveCriticalSection(m)
+#    define _XPL_COND_INIT(c) InitializeConditionVariable(c)
+#    define _XPL_COND_FREE(c) ((void)(c))
+#    define _XPL_WAIT(c, m) SleepConditionVariableCS((c), (m), INFINITE)
+#    define _XPL_BROADCAST(c) WakeAllConditionVariable(c)
+#  else
+#    define _XPL_THREAD pthread_t
+#    define _XPL_MUTEX pthread_mutex_t
+#    define _XPL_COND pthread_cond_t
+#    define _XPL_MUTEX_INIT(m) pthread_mutex_init((m), NULL)
+#    define _XPL_MUTEX_FREE(m) pthread_mutex_destroy(m)
+#    define _XPL_LOCK(m) pthread_mutex_lock(m)
+#    define _XPL_UNLOCK(m) pthread_mutex_unlock(m)
+#    define _XPL_COND_INIT(c) pthread_cond_init((c), NULL)
+#    define _XPL_COND_FREE(c) pthread_cond_destroy(c)
+#    define _XPL_WAIT(c, m) pthread_cond_wait((c), (m))
+#    define _XPL_BROADCAST(c) pthread_cond_broadcast(c)
+#  endif
+#endif /* XPL_ENABLE_POOL || XPL_ENABLE_SCRIPT_CACHE */
+
+/**
+ * @brief Bits of the hash prefix used to bucket the interface dispatch index,
+ *  the index takes (1 << XPL_DISPATCH_BITS) + 1 integers in a context.
+ */
+#ifndef XPL_DISPATCH_BITS
+#  define XPL_DISPATCH_BITS 8
+#endif /* !XPL_DISPATCH_BITS */
+
+/**
+ * @brief Entry count of the per context branch skipping cache, must be a
+ *  power of 2.
+ */
+#ifndef XPL_BRANCH_CACHE_SIZE
+#  define XPL_BRANCH_CACHE_SIZE 64
+#endif /* !XPL_BRANCH_CACHE_SIZE */
+
+/**
+ * @brief Entry count of the per context pure predicate cache, must be a
+ *  power of 2.
+ */
+#ifndef XPL_MEMO_SIZE
+#  define XPL_MEMO_SIZE 64
+#endif /* !XPL_MEMO_SIZE */
+
+/**
+ * @brief Budget units between two deadline clock reads, must be a power of 2.
+ */
+#ifndef XPL_DEADLINE_INTERVAL
+#  define XPL_DEADLINE_INTERVAL 64
+#endif /* !XPL_DEADLINE_INTERVAL */
+
+/**
+ * @brief Allocator of registries built by xpl_open and of the script cache,
+ *  the only heap users.
+ */
+#ifndef XPL_MALLOC
+#  define XPL_MALLOC(s) malloc(s)
+#endif /* !XPL_MALLOC */
+#ifndef XPL_FREE
+#  define XPL_FREE(p) free(p)
+#endif /* !XPL_FREE */
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+/**
+ * @brief Bucket count of the script cache, must be a power of 2.
+ */
+#  ifndef XPL_SCRIPT_CACHE_BUCKETS
+#    define XPL_SCRIPT_CACHE_BUCKETS 256
+#  endif /* !XPL_SCRIPT_CACHE_BUCKETS */
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+/**
+ * @brief Magic number and format version of compiled images.
+ */
+#define XPL_IMAGE_MAGIC 0x494c5058u
+#define XPL_IMAGE_VERSION 2u
+
+/**
+ * @brief Max nesting depth of 'if' statements.
+ */
+#ifndef XPL_IF_STACK_SIZE
+#  define XPL_IF_STACK_SIZE 64
+#endif /* !XPL_IF_STACK_SIZE */
+
+/**
+ * @brief Max count of batch lanes, bits of xpl_lanes_t.
  */
-#ifndef XPL_DO_NOTHING
-#  define XPL_DO_NOTHING(s) do { (s)->pfunc_hack += __LINE__; } while(0)
-#endif /* !XPL_DO_NOTHING */
+#define XPL_MAX_LANES 64
 
 /**
  * @brief XPL function execution status.
@@ -128,9 +345,21 @@ typedef enum xpl_status_t {
   XS_NO_PARAM,              /**< No param found. */
   XS_PARAM_TYPE_ERROR,      /**< Parameter convertion failed. */
   XS_BAD_ESCAPE_FORMAT,     /**< Bad escape format. */
+  XS_PREEMPTED,             /**< Execution budget ran out, resumable. */
+  XS_IMAGE_MISMATCH,        /**< Compiled image doesn't match, script text is interpreted. */
   XS_COUNT
 } xpl_status_t;
 
+/**
+ * @brief Interface flags.
+ */
+typedef enum xpl_func_flags_t {
+  XFF_NONE = 0,             /**< No flags. */
+  XFF_SIDE_EFFECT = 1 << 0, /**< Always runs, never skipped by short circuit evaluation. */
+  XFF_PURE = 1 << 1,        /**< Predicate which pushes one boolean depending only on its parameters, cached per context. */
+  XFF_SORTED = 1 << 2       /**< Set on the terminator once xpl_registry_build hashed and sorted the array. */
+} xpl_func_flags_t;
+
 /**
  * @brief Boolean value composing type.
  */
@@ -140,6 +369,37 @@ typedef enum xpl_bool_composing_t {
   XBC_AND  /**< Composes and assigns old value AND a new value. */
 } xpl_bool_composing_t;
 
+/**
+ * @brief Pending branch skipping kind.
+ */
+typedef enum xpl_skip_kind_t {
+  XSK_NONE,   /**< Not skipping. */
+  XSK_BRANCH, /**< Skipping an untaken body to the next branch keyword. */
+  XSK_ENDIF   /**< Skipping rest branches to 'endif'. */
+} xpl_skip_kind_t;
+
+/**
+ * @brief Access pattern hint of a memory mapped script file.
+ */
+typedef enum xpl_access_hint_t {
+  XAH_NORMAL,     /**< No special treatment. */
+  XAH_SEQUENTIAL, /**< Read ahead aggressively, pages could be freed soon after. */
+  XAH_WILLNEED    /**< Read the whole file in ahead of running. */
+} xpl_access_hint_t;
+
+/**
+ * @brief Character class bits.
+ */
+typedef enum xpl_char_class_t {
+  XCC_BLANK = 1 << 0,        /**< Blank. */
+  XCC_SQUOTE = 1 << 1,       /**< Single quote, comment delimiter. */
+  XCC_DQUOTE = 1 << 2,       /**< Double quote, string delimiter. */
+  XCC_COMMA = 1 << 3,        /**< Comma, statement delimiter. */
+  XCC_SEPARATOR = 1 << 4,    /**< Buildin separator. */
+  XCC_SEPARATOR_EX = 1 << 5, /**< Buildin or customized separator. */
+  XCC_END = 1 << 6           /**< Terminator. */
+} xpl_char_class_t;
+
 struct xpl_context_t;
 
 /**
@@ -153,10 +413,106 @@ typedef xpl_status_t (* xpl_func_t)(struct xpl_context_t* _s);
  * @brief XPL scripting programming interface information.
  */
 typedef struct xpl_func_info_t {
-  const char* name; /**< Interface name. */
-  xpl_func_t func;  /**< Pointer to interface function. */
+  const char* name;   /**< Interface name. */
+  xpl_func_t func;    /**< Pointer to interface function. */
+  int flags;          /**< Interface flags, combination of xpl_func_flags_t. */
+  unsigned hash;      /**< Hash of interface name, filled when opening. */
+  int length;         /**< Length of interface name, filled when opening. */
+  const char* symbol; /**< C expression of the function, used by the translator. */
 } xpl_func_info_t;
 
+/**
+ * @brief String view, points to a piece of chars without terminator.
+ */
+typedef struct xpl_string_view_t {
+  const char* ptr; /**< Pointer to the first char. */
+  size_t len;      /**< Count of chars. */
+} xpl_string_view_t;
+
+/**
+ * @brief Compiled instruction, a resolved interface with its parameter span.
+ */
+typedef struct xpl_instr_t {
+  int func;        /**< Index of resolved interface in registry. */
+  int param_begin; /**< Offset of the first parameter in source text. */
+  int param_end;   /**< Offset after the last parameter in source text. */
+  int jump;        /**< Branch target instruction index, -1 if none. */
+} xpl_instr_t;
+
+/**
+ * @brief Literal flags.
+ */
+typedef enum xpl_literal_flags_t {
+  XLF_INT = 1 << 0,     /**< Converted to a 64-bit signed integer. */
+  XLF_DOUBLE = 1 << 1,  /**< Converted to a double float. */
+  XLF_QUOTED = 1 << 2,  /**< Quoted string. */
+  XLF_ESCAPED = 1 << 3  /**< Quoted string with escapes, decoded when popped. */
+} xpl_literal_flags_t;
+
+/**
+ * @brief Pre-parsed parameter, converted once when compiling.
+ */
+typedef struct xpl_literal_t {
+  xpl_int64_t integer; /**< Integer value, valid with XLF_INT. */
+  double real;         /**< Real value, valid with XLF_DOUBLE. */
+  int begin;           /**< Offset of the parameter in source text. */
+  int end;             /**< Offset after the parameter in source text. */
+  int value_begin;     /**< Offset of the string value, quotes excluded. */
+  int value_end;       /**< Offset after the string value. */
+  int flags;           /**< Literal flags, combination of xpl_literal_flags_t. */
+} xpl_literal_t;
+
+/**
+ * @brief Compiled program, a flat instruction stream of a loaded script.
+ */
+typedef struct xpl_program_t {
+  const xpl_instr_t* instrs;     /**< Pointer to array of instructions. */
+  int instrs_count;              /**< Count of instructions. */
+  const xpl_literal_t* literals; /**< Pre-parsed parameters by offset, NULL if not parsed. */
+  int literals_count;            /**< Count of literals. */
+} xpl_program_t;
+
+/**
+ * @brief Header of a compiled image, a binary form of a compiled program
+ *  which is followed by its instructions, then by its literals from the next
+ *  offset aligned to double if any; all are in native byte order and usable
+ *  in place.
+ */
+typedef struct xpl_image_header_t {
+  unsigned magic;         /**< XPL_IMAGE_MAGIC, mismatches in other byte orders. */
+  unsigned version;       /**< XPL_IMAGE_VERSION. */
+  unsigned instr_size;    /**< Size of an instruction. */
+  unsigned literal_size;  /**< Size of a literal. */
+  unsigned escape_mode;   /**< 0 without escapes, 1 with buildin escapes, 2 with customized ones. */
+  unsigned registry_hash; /**< Hash of interface names in registry order. */
+  unsigned text_hash;     /**< Hash of source text. */
+  int text_length;        /**< Length of source text. */
+  int instrs_count;       /**< Count of instructions. */
+  int literals_count;     /**< Count of literals. */
+} xpl_image_header_t;
+
+/**
+ * @brief Frame of a running 'if' statement.
+ */
+typedef struct xpl_if_frame_t {
+  xpl_lanes_t outer_lanes;     /**< Active lanes before the statement. */
+  xpl_lanes_t remaining_lanes; /**< Lanes that haven't taken a branch yet. */
+  int taken;                   /**< Non-zero while running a branch body. */
+} xpl_if_frame_t;
+
+/**
+ * @brief Cached result of a pure predicate.
+ */
+typedef struct xpl_memo_t {
+  const xpl_func_info_t* func; /**< Predicate interface. */
+  const char* params;          /**< Raw parameter text in script. */
+  int params_length;           /**< Length of raw parameter text. */
+  unsigned hash;               /**< Hash of predicate and parameter text. */
+  unsigned epoch;              /**< Cache epoch when stored. */
+  xpl_lanes_t lanes;           /**< Lanes evaluated. */
+  xpl_lanes_t value;           /**< Pushed boolean value of evaluated lanes. */
+} xpl_memo_t;
+
 /**
  * @brief Separator determination functor.
  *
@@ -181,41 +537,240 @@ typedef int (* xpl_is_escape_func)(unsigned char _c);
  */
 typedef int (* xpl_parse_escape_func)(char** _d, const char** _s);
 
+/**
+ * @brief Stream reader.
+ *
+ * @param[in] _u  - Pointer to user defined data.
+ * @param[out] _b - Pointer to destination buffer.
+ * @param[in] _l  - Destination buffer size.
+ * @return - Returns count of read chars, zero or negative if no more.
+ */
+typedef int (* xpl_reader_func)(void* _u, char* _b, int _l);
+
+/**
+ * @brief Monotonic clock of deadline based execution.
+ *
+ * @param[in] _u - User defined data.
+ * @return - Returns current time in any unit of the deadline.
+ */
+typedef xpl_uint64_t (* xpl_clock_func)(void* _u);
+
+/**
+ * @brief Interface registry, sorted and indexed once, then read-only and
+ *  shareable by contexts on any thread.
+ */
+typedef struct xpl_registry_t {
+  const xpl_func_info_t* funcs;               /**< Pointer to array of registered interfaces. */
+  int funcs_count;                            /**< Count of registered interfaces. */
+  int dispatch[(1 << XPL_DISPATCH_BITS) + 1]; /**< Interface index by hash prefix, or displacement and interface index by perfect hash bucket and slot. */
+  unsigned seed;                              /**< Multiplier of perfect hash buckets, zero if indexed by hash prefix. */
+  unsigned char char_class[256];              /**< Character class table without customized separator. */
+} xpl_registry_t;
+
+#ifdef XPL_ENABLE_PROFILER
+/**
+ * @brief Profiled counters of an interface, branch keywords run inline by
+ *  compiled programs are not counted.
+ */
+typedef struct xpl_prof_func_t {
+  xpl_uint64_t calls;     /**< Count of calls. */
+  xpl_uint64_t inclusive; /**< Ticks spent in calls, including nested calls. */
+  xpl_uint64_t exclusive; /**< Ticks spent in calls, excluding nested calls. */
+} xpl_prof_func_t;
+
+/**
+ * @brief Profiled counters of a 'then' branch.
+ */
+typedef struct xpl_prof_branch_t {
+  int offset;           /**< Source offset of the branch body, -1 if unused. */
+  xpl_uint64_t taken;   /**< Count of entering the body. */
+  xpl_uint64_t skipped; /**< Count of skipping the body. */
+} xpl_prof_branch_t;
+
+/**
+ * @brief Profile dumping format.
+ */
+typedef enum xpl_prof_format_t {
+  XPF_CSV,  /**< Comma separated values, one row per interface or branch. */
+  XPF_JSON  /**< JSON object with arrays of interfaces and branches. */
+} xpl_prof_format_t;
+
+/**
+ * @brief Profile of contexts sharing a registry, in caller provided buffers.
+ */
+typedef struct xpl_profile_t {
+  const xpl_registry_t* registry; /**< Registry profiled. */
+  xpl_prof_func_t* funcs;         /**< Counters of interfaces, in registry order. */
+  xpl_prof_branch_t* branches;    /**< Counters of branches, hashed by offset. */
+  int branches_size;              /**< Capacity of the branch table. */
+  int branches_count;             /**< Count of used branch entries. */
+  xpl_uint64_t nested;            /**< Ticks of nested calls in the running call. */
+} xpl_profile_t;
+#endif /* XPL_ENABLE_PROFILER */
+
+#ifdef XPL_ENABLE_TRACE
+/**
+ * @brief Trace event kind. Interpreted and compiled runs of a script emit
+ *  the same sequence of events, keywords included; offsets of compiled runs
+ *  point to parameters rather than to interface names.
+ */
+typedef enum xpl_trace_kind_t {
+  XTK_CALL,       /**< An interface is called. */
+  XTK_RETURN,     /**< An interface returned, with its status. */
+  XTK_TAKEN,      /**< A 'then' enters its body. */
+  XTK_SKIPPED,    /**< A 'then' skips its body. */
+  XTK_SKIP_BEGIN, /**< Skipping an execution body begins. */
+  XTK_SKIP_END    /**< Skipping an execution body ends. */
+} xpl_trace_kind_t;
+
+/**
+ * @brief Trace event.
+ */
+typedef struct xpl_trace_event_t {
+  xpl_uint64_t ticks;   /**< Timestamp in ticks. */
+  int offset;           /**< Cursor offset in source text. */
+  int func;             /**< Interface index in registry, -1 if none. */
+  unsigned char kind;   /**< Event kind, one of xpl_trace_kind_t. */
+  unsigned char status; /**< Returned status of XTK_RETURN. */
+} xpl_trace_event_t;
+
+/**
+ * @brief Single producer single consumer ring of trace events, the running
+ *  context produces and another thread could consume.
+ */
+typedef struct xpl_trace_ring_t {
+  xpl_trace_event_t* events; /**< Pointer to event buffer. */
+  unsigned size;             /**< Capacity of event buffer, a power of 2. */
+  unsigned head;             /**< Count of produced events. */
+  unsigned tail;             /**< Count of consumed events. */
+  unsigned dropped;          /**< Count of events dropped when full, written by producer. */
+  xpl_uint64_t base;         /**< Ticks when opened. */
+  double base_us;            /**< Reference clock in microseconds when opened. */
+  double ticks_per_us;       /**< Ticks per microsecond if the clock tells, zero for a cycle counter. */
+} xpl_trace_ring_t;
+#endif /* XPL_ENABLE_TRACE */
+
 /**
  * @brief XPL context structure.
  */
 typedef struct xpl_context_t {
   /**
-   * @brief Registered interfaces.
+   * @brief Registered interfaces, reached through registry->funcs and
+   *  registry->funcs_count, which replace the former funcs and funcs_count
+   *  fields of the context.
    */
   /* {===== */
-    xpl_func_info_t* funcs; /**< Pointer to array of registered interfaces. */
-    int funcs_count;        /**< Count of registered interfaces. */
+    const xpl_registry_t* registry; /**< Registry in use, shared or own. */
+    xpl_registry_t* own_registry;   /**< Registry allocated by xpl_open and freed by xpl_close, NULL if shared. */
   /* =====} */
   /**
    * @brief Script source code indicator.
    */
   /* {===== */
-    const char* text;   /**< Script source text. */
-    const char* cursor; /**< Script execution cursor. */
+    const char* text;     /**< Script source text. */
+    const char* text_end; /**< End of script source text. */
+    const char* cursor;   /**< Script execution cursor. */
+  /* =====} */
+  /**
+   * @brief Memory mapped script file.
+   */
+  /* {===== */
+    void* mapping;             /**< Mapped view of the script file, NULL if not mapped. */
+    size_t mapping_size;       /**< Size of the mapped view. */
+    void* image_mapping;       /**< Mapped view of the compiled image file, NULL if not mapped. */
+    size_t image_mapping_size; /**< Size of the mapped image view. */
+  /* =====} */
+  /**
+   * @brief Streaming input, script text slides through a window buffer.
+   */
+  /* {===== */
+    xpl_reader_func reader; /**< Stream reader, NULL if not streaming. */
+    void* reader_userdata;  /**< User defined data passed to the reader. */
+    char* window;           /**< Window buffer of streamed text. */
+    int window_size;        /**< Window buffer size. */
+    int stream_eof;         /**< Non-zero if the reader reached its end. */
+    int stream_in_comment;  /**< Non-zero if a comment crosses window end. */
+  /* =====} */
+  /**
+   * @brief Compiled program indicator.
+   */
+  /* {===== */
+    const xpl_program_t* program; /**< Compiled program of current script. */
+    int pc;                       /**< Program execution counter. */
+    int literal;                  /**< Index of the next literal to be popped. */
+    const char* param_end;        /**< End of parameters of current instruction. */
   /* =====} */
   /**
    * @brief Boolean value.
    */
   /* {===== */
     xpl_bool_composing_t bool_composing; /**< Boolean value composing type. */
-    int bool_value;                      /**< Current boolean value. */
+    xpl_lanes_t bool_value;              /**< Current boolean value, a mask of lanes. */
+  /* =====} */
+  /**
+   * @brief Batch lanes, one lane per record evaluated by a single run.
+   */
+  /* {===== */
+    xpl_lanes_t lanes;        /**< All lanes of current batch. */
+    xpl_lanes_t active_lanes; /**< Lanes running current statement. */
   /* =====} */
   /**
    * @brief Nest logic helper.
    */
   /* {===== */
-    int if_statement_depth; /**< 'if' statement depth. */
+    int if_statement_depth;                     /**< 'if' statement depth. */
+    xpl_if_frame_t if_frames[XPL_IF_STACK_SIZE]; /**< Frames of running 'if' statements. */
+  /* =====} */
+  /**
+   * @brief Pending branch skipping, resumed by the next step.
+   */
+  /* {===== */
+    xpl_skip_kind_t skip_kind; /**< Kind of pending skipping. */
+    int skip_body;             /**< Non-zero while skipping an execution body. */
+    int skip_nest;             /**< Nested 'if' depth in skipped body. */
+    int skip_key;              /**< Branch cache key of skipped body. */
+    int skip_endif_key;        /**< Branch cache key of skipping to 'endif'. */
+  /* =====} */
+  /**
+   * @brief Execution budget.
+   */
+  /* {===== */
+    int budget;                 /**< Remaining budget units, negative if unlimited. */
+    xpl_clock_func clock;       /**< Deadline clock, NULL if no deadline. */
+    void* clock_userdata;       /**< User defined data passed to the clock. */
+    xpl_uint64_t deadline;      /**< Deadline in clock unit. */
+  /* =====} */
+  /**
+   * @brief Scratch arena over a user buffer, reset at the start of each step.
+   */
+  /* {===== */
+    char* scratch;    /**< Backing buffer of scratch arena, NULL if none. */
+    int scratch_size; /**< Backing buffer size. */
+    int scratch_used; /**< Bytes allocated in current step. */
+  /* =====} */
+  /**
+   * @brief Branch skipping cache, also parameter ends of pure predicate call
+   *  sites, valid until another script is loaded.
+   */
+  /* {===== */
+    int branch_from[XPL_BRANCH_CACHE_SIZE]; /**< Keys of skipping start offsets, or complemented call site offsets. */
+    int branch_to[XPL_BRANCH_CACHE_SIZE];   /**< Skipping target offsets, or parameter end offsets. */
+  /* =====} */
+  /**
+   * @brief Pure predicate cache, valid in current epoch.
+   */
+  /* {===== */
+    xpl_memo_t memo[XPL_MEMO_SIZE]; /**< Cached results. */
+    unsigned memo_epoch;            /**< Current epoch, bumped to invalidate all results. */
   /* =====} */
   /**
    * @brief Separator determination functor.
    */
   xpl_is_separator_func separator_detect;
+  /**
+   * @brief Character class table, built from separator functor when opening.
+   */
+  unsigned char char_class[256];
   /**
    * @brief Escape determination functor.
    */
@@ -228,15 +783,147 @@ typedef struct xpl_context_t {
    * @brief Pointer to user defined data.
    */
   void* userdata;
+#ifdef XPL_ENABLE_PROFILER
   /**
-   * @brief Used to avoids function folding optimization during compiling time.
+   * @brief Attached profile, NULL if not profiling.
    */
-  /* {===== */
-    int use_hack_pfunc; /**< Use pfunc hacking if non-zero. */
-    int pfunc_hack;     /**< Dummy function hack. */
-  /* =====} */
+  struct xpl_profile_t* profile;
+#endif /* XPL_ENABLE_PROFILER */
+#ifdef XPL_ENABLE_TRACE
+  /**
+   * @brief Attached trace ring, NULL if not tracing.
+   */
+  xpl_trace_ring_t* trace;
+#endif /* XPL_ENABLE_TRACE */
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+  /**
+   * @brief Prepared script shared from a script cache, NULL if not cached.
+   */
+  struct xpl_prepared_t* prepared;
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
 } xpl_context_t;
 
+/**
+ * @brief Scheduler completion callback.
+ *
+ * @param[in] _s - Completed context.
+ * @param[in] _r - Final execution status.
+ */
+typedef void (* xpl_scheduler_done_func)(xpl_context_t* _s, xpl_status_t _r);
+
+/**
+ * @brief Cooperative scheduler, resumes suspended contexts in round robin.
+ */
+typedef struct xpl_scheduler_t {
+  xpl_context_t** contexts;     /**< Pointer to array of scheduled contexts. */
+  int contexts_count;           /**< Count of scheduled contexts. */
+  int contexts_size;            /**< Capacity of the context array. */
+  xpl_scheduler_done_func done; /**< Completion callback, could be NULL. */
+  int budget;                   /**< Max steps per context per tick, zero if unlimited. */
+} xpl_scheduler_t;
+
+#ifdef XPL_ENABLE_POOL
+struct xpl_job_t;
+struct xpl_pool_t;
+
+/**
+ * @brief Job completion callback, called on the worker thread which ran it.
+ *
+ * @param[in] _j - Completed job.
+ */
+typedef void (* xpl_job_done_func)(struct xpl_job_t* _j);
+
+/**
+ * @brief Pool job, a script with its user data, owned by the caller until
+ *  completed.
+ */
+typedef struct xpl_job_t {
+  const char* text;       /**< Script source text. */
+  size_t length;          /**< Length of the text. */
+  void* userdata;         /**< User defined data assigned to the running context. */
+  xpl_status_t status;    /**< Execution status, filled when completed. */
+  int worker;             /**< Index of the worker which ran it. */
+  struct xpl_job_t* prev; /**< Previous job in a worker queue. */
+  struct xpl_job_t* next; /**< Next job in a worker queue. */
+} xpl_job_t;
+
+/**
+ * @brief Pool worker, a thread with its own context and job queue.
+ */
+typedef struct xpl_worker_t {
+  struct xpl_pool_t* pool; /**< Owner pool. */
+  int index;               /**< Index in the pool. */
+  xpl_context_t context;   /**< Context copied from the prototype. */
+  xpl_job_t* head;         /**< Queue head, popped by the owner. */
+  xpl_job_t* tail;         /**< Queue tail, stolen by others. */
+  _XPL_MUTEX lock;         /**< Queue lock. */
+  _XPL_THREAD thread;      /**< Worker thread. */
+} xpl_worker_t;
+
+/**
+ * @brief Worker pool, runs jobs in parallel with work stealing.
+ */
+typedef struct xpl_pool_t {
+  xpl_worker_t* workers;  /**< Pointer to array of workers. */
+  int workers_count;      /**< Count of workers. */
+  xpl_job_done_func done; /**< Job completion callback, could be NULL. */
+  _XPL_MUTEX lock;        /**< Pool lock of the counters below. */
+  _XPL_COND wake;         /**< Signaled when jobs queued or stopping. */
+  _XPL_COND idle;         /**< Signaled when all jobs completed. */
+  unsigned submits;       /**< Count of linked jobs ever, lets an idle worker sleep until more are linked. */
+  int outstanding;        /**< Count of submitted but not completed jobs. */
+  int next;               /**< Worker to queue the next job. */
+  int stopping;           /**< Non-zero if closing. */
+} xpl_pool_t;
+#endif /* XPL_ENABLE_POOL */
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+/**
+ * @brief Prepared script, a copy of script text with its compiled program
+ *  and literals in a single allocation, shared read-only by contexts.
+ */
+typedef struct xpl_prepared_t {
+  struct xpl_script_cache_t* cache;       /**< Owner cache. */
+  struct xpl_prepared_t* prev;            /**< More recently used entry. */
+  struct xpl_prepared_t* next;            /**< Less recently used entry. */
+  struct xpl_prepared_t* chain;           /**< Next entry in the same bucket. */
+  xpl_uint64_t hash;                      /**< Hash of script text. */
+  const xpl_func_info_t* funcs;           /**< Interfaces of the registry, identity of the registry. */
+  xpl_is_separator_func separator_detect; /**< Separator functor of the preparing context. */
+  xpl_is_escape_func escape_detect;       /**< Escape functor of the preparing context. */
+  xpl_parse_escape_func escape_parse;     /**< Escape parser of the preparing context. */
+  const char* text;                       /**< Copy of script text. */
+  size_t length;                          /**< Length of script text. */
+  size_t size;                            /**< Allocated bytes. */
+  int refs;                               /**< Count of contexts using it. */
+  xpl_program_t program;                  /**< Compiled program with literals. */
+} xpl_prepared_t;
+
+/**
+ * @brief Counters of a script cache.
+ */
+typedef struct xpl_script_cache_stats_t {
+  xpl_uint64_t hits;      /**< Loads which reused a prepared script. */
+  xpl_uint64_t misses;    /**< Loads which prepared a script. */
+  xpl_uint64_t evictions; /**< Prepared scripts evicted by the memory cap. */
+  int entries;            /**< Count of cached prepared scripts. */
+  size_t size;            /**< Bytes of cached prepared scripts. */
+} xpl_script_cache_stats_t;
+
+/**
+ * @brief Thread safe cache of prepared scripts, keyed by script text and
+ *  registry, with reference counting and a least recently used memory cap.
+ */
+typedef struct xpl_script_cache_t {
+  xpl_prepared_t* buckets[XPL_SCRIPT_CACHE_BUCKETS]; /**< Hash buckets. */
+  xpl_prepared_t* head;                              /**< Most recently used entry. */
+  xpl_prepared_t* tail;                              /**< Least recently used entry. */
+  size_t capacity;                                   /**< Memory cap in bytes. */
+  xpl_script_cache_stats_t stats;                    /**< Counters. */
+  _XPL_MUTEX lock;                                   /**< Cache lock. */
+} xpl_script_cache_t;
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
 /* ========================================================} */
 
 /*
@@ -245,14 +932,57 @@ typedef struct xpl_context_t {
 */
 
 /**
- * @brief Opens an XPL context.
+ * @brief Builds an interface registry, the interface array is hashed and
+ *  sorted in place and must not be modified afterwards; an array whose
+ *  terminator was flagged XFF_SORTED by an earlier build is used as is
+ *  without being written.
+ *
+ * @param[out] _r - Interface registry.
+ * @param[in] _f  - Pointer to XPL scripting interface array.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_registry_build(xpl_registry_t* _r, xpl_func_info_t* _f);
+/**
+ * @brief Builds an interface registry from a prepared interface array with
+ *  filled hashes and lengths, and a two level perfect hash dispatch index,
+ *  without sorting. A hash goes to bucket
+ *  b = ((hash * _m) & 0xffffffff) >> (32 - XPL_DISPATCH_BITS), whose
+ *  displacement is the high 16 bits of _d[b]; the interface is then at slot
+ *  _xpl_perfect_slot(hash, displacement), whose low 16 bits of _d hold the
+ *  interface index, or 0xffff if the slot is empty.
+ *
+ * @param[out] _r - Interface registry.
+ * @param[in] _f  - Pointer to prepared XPL scripting interface array.
+ * @param[in] _m  - Odd multiplier of perfect hash buckets.
+ * @param[in] _d  - Perfect hash dispatch index of (1 << XPL_DISPATCH_BITS)
+ *  buckets and slots.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_registry_build_perfect(xpl_registry_t* _r, const xpl_func_info_t* _f, unsigned _m, const int* _d);
+
+/**
+ * @brief Opens an XPL context, allocates a registry of the interface array
+ *  owned by the context, and sorts the array on its first open. The first
+ *  open writes the array, so it is not safe against concurrent opens on a
+ *  shared array; build a registry once with xpl_registry_build and use
+ *  xpl_open_registry for that.
  *
  * @param[in] _s  - XPL context.
  * @param[in] _f  - Pointer to XPL scripting interface array.
  * @param[in] _is - Separator determination functor.
- * @return - Returns execution status.
+ * @return - Returns execution status, XS_ERR if out of memory.
  */
 XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_func_info_t* _f, xpl_is_separator_func _is);
+/**
+ * @brief Opens an XPL context with a built registry, which must outlive the
+ *  context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _r  - Interface registry.
+ * @param[in] _is - Separator determination functor.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_open_registry(xpl_context_t* _s, const xpl_registry_t* _r, xpl_is_separator_func _is);
 /**
  * @brief Closes an XPL context.
  *
@@ -268,6 +998,43 @@ XPLAPI xpl_status_t xpl_close(xpl_context_t* _s);
  * @return - Returns execution status.
  */
 XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t);
+/**
+ * @brief Loads a script with specific length, the text doesn't need a
+ *  terminator.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _t - Script source text.
+ * @param[in] _l - Length of the text.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_load_n(xpl_context_t* _s, const char* _t, size_t _l);
+/**
+ * @brief Loads a script file by mapping it into memory read-only without
+ *  copying, the mapping is released when unloading.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _p - Path of the script file.
+ * @param[in] _a - Access pattern hint.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_load_file(xpl_context_t* _s, const char* _p, xpl_access_hint_t _a);
+/**
+ * @brief Loads a script from a stream, the text is read through a window
+ *  buffer while running. Before each statement the window is refilled to
+ *  hold at least half of its size ahead of cursor, and refilled entirely if
+ *  the statement with its parameters reaches the window end; a statement
+ *  longer than the window fails with XS_NO_ENOUGH_BUFFER_SIZE before its
+ *  interface is called. String views are valid until the next statement. A
+ *  streamed script can't be reloaded or compiled.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _r - Stream reader.
+ * @param[in] _u - User defined data passed to the reader.
+ * @param[in] _b - Pointer to window buffer.
+ * @param[in] _l - Window buffer size.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_load_stream(xpl_context_t* _s, xpl_reader_func _r, void* _u, char* _b, int _l);
 /**
  * @brief Reloads current script, set execution cursor to the beginning.
  *
@@ -294,6 +1061,8 @@ XPLAPI xpl_status_t xpl_run(xpl_context_t* _s);
  * @brief Tries to peek one function.
  *
  * @param[in] _s - XPL context.
+ * @param[out] _f - Peeked interface, NULL if none; it belongs to the registry
+ *  and must not be modified.
  * @return - Returns execution status.
  */
 XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f);
@@ -306,65 +1075,524 @@ XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f);
 XPLAPI xpl_status_t xpl_step(xpl_context_t* _s);
 
 /**
- * @brief Skips a piece of comment.
+ * @brief Compiles current script into a flat instruction stream, and attaches
+ *  the compiled program to the XPL context.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _s  - XPL context.
+ * @param[out] _p - Compiled program.
+ * @param[in] _c  - Pointer to instruction buffer.
+ * @param[in] _l  - Instruction buffer size.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_compile(xpl_context_t* _s, xpl_program_t* _p, xpl_instr_t* _c, int _l);
 /**
- * @brief Determines whether there's a parameter in current XPL context at
- *  cursor point.
+ * @brief Compiles current script like xpl_compile, and pre-parses every
+ *  parameter into a typed literal, so popping a parameter of the program
+ *  returns the converted value without scanning the source text again.
+ *  Literals follow the escape functors in use when compiling.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _p - Compiled program.
+ * @param[in] _c  - Pointer to instruction buffer.
+ * @param[in] _l  - Instruction buffer size.
+ * @param[in] _v  - Pointer to literal buffer, could be NULL.
+ * @param[in] _m  - Literal buffer size.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_compile_literals(xpl_context_t* _s, xpl_program_t* _p, xpl_instr_t* _c, int _l, xpl_literal_t* _v, int _m);
+/**
+ * @brief Runs a compiled program.
  *
  * @param[in] _s - XPL context.
- * @return - Returns execution status, XS_OK if there's a parameter, or
- *  XS_NO_PARAM if not.
+ * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_run_compiled(xpl_context_t* _s);
 /**
- * @brief Skips a string parameter from XPL context.
+ * @brief Runs a single compiled instruction.
  *
  * @param[in] _s - XPL context.
- * @return - Returns execution status, XS_OK if succeed.
+ * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_step_compiled(xpl_context_t* _s);
 /**
- * @brief Pops a long integer parameter from XPL context.
+ * @brief Saves the compiled program of current script as a compiled image.
  *
  * @param[in] _s  - XPL context.
- * @param[out] _o - Destination buffer.
+ * @param[in] _fp - Output file.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_pop_long(xpl_context_t* _s, long* _o);
+XPLAPI xpl_status_t xpl_image_save(xpl_context_t* _s, FILE* _fp);
 /**
- * @brief Pops a double float parameter from XPL context.
+ * @brief Attaches a compiled image of current script as its compiled program,
+ *  the instructions and literals are used in place and the image must
+ *  outlive the program. The image is checked against the source text, the registry, its
+ *  own bounds and branch targets, which must jump forward to a matching
+ *  'elseif', 'else' or 'endif'; if mismatched, no program is attached and the script is
+ *  still runnable by xpl_run.
  *
  * @param[in] _s  - XPL context.
- * @param[out] _o - Destination buffer.
- * @return - Returns execution status.
+ * @param[out] _p - Compiled program.
+ * @param[in] _b  - Pointer to compiled image, aligned to double if it has
+ *  literals, otherwise to int.
+ * @param[in] _l  - Size of compiled image.
+ * @return - Returns XS_IMAGE_MISMATCH if mismatched, otherwise execution
+ *  status.
  */
-XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o);
+XPLAPI xpl_status_t xpl_image_load(xpl_context_t* _s, xpl_program_t* _p, const void* _b, size_t _l);
 /**
- * @brief Pops a string parameter from XPL context.
+ * @brief Maps a compiled image file and attaches it like xpl_image_load, the
+ *  mapping is released when the script unloads.
  *
  * @param[in] _s  - XPL context.
- * @param[out] _o - Destination buffer.
- * @param[in] _l  - Destination buffer size.
- * @return - Returns execution status.
+ * @param[out] _p - Compiled program.
+ * @param[in] _f  - Path of compiled image file.
+ * @return - Returns XS_IMAGE_MISMATCH if mismatched or unreadable, otherwise
+ *  execution status.
  */
-XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l);
+XPLAPI xpl_status_t xpl_image_load_file(xpl_context_t* _s, xpl_program_t* _p, const char* _f);
 /**
- * @brief Pushes a boolean value to XPL context.
+ * @brief Runs current script or compiled program for at most a number of
+ *  steps, a step is an interface call, a compiled instruction or a piece of
+ *  branch skipping.
  *
  * @param[in] _s - XPL context.
- * @param[in] _b - Boolean value.
- * @return - Returns execution status.
+ * @param[in] _n - Max steps to run.
+ * @return - Returns XS_PREEMPTED if budget ran out, run again to resume,
+ *  otherwise execution status.
  */
-XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b);
-
+XPLAPI xpl_status_t xpl_run_budget(xpl_context_t* _s, int _n);
+/**
+ * @brief Runs current script or compiled program until a deadline, the clock
+ *  is read every XPL_DEADLINE_INTERVAL steps.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _c - Monotonic clock.
+ * @param[in] _u - User defined data passed to the clock.
+ * @param[in] _d - Deadline in clock unit.
+ * @return - Returns XS_PREEMPTED if deadline passed, run again to resume,
+ *  otherwise execution status.
+ */
+XPLAPI xpl_status_t xpl_run_deadline(xpl_context_t* _s, xpl_clock_func _c, void* _u, xpl_uint64_t _d);
+/**
+ * @brief Translates current script into a C function ahead of time, the
+ *  output is meant to be included after xpl.h and declarations of every used
+ *  interface function. Interfaces are called directly by their symbols,
+ *  branches become gotos and parameters are popped from the embedded script
+ *  text. The function runs like xpl_run_compiled, it loads its script when
+ *  the program counter is zero, and resumes at the program counter after a
+ *  yield or a failed call; profiling and tracing are not emitted. Pure
+ *  predicates are called through the result cache by their registry index,
+ *  which is checked against the context registry on load, the function
+ *  returns XS_ERR if the registry doesn't match.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _c  - Pointer to instruction buffer used while translating.
+ * @param[in] _l  - Instruction buffer size.
+ * @param[in] _n  - Name of the emitted function, the script text is named
+ *  with a '_text' suffix.
+ * @param[in] _fp - Output file.
+ * @return - Returns XS_ERR if the script can't compile or any interface has
+ *  no symbol, otherwise execution status.
+ */
+XPLAPI xpl_status_t xpl_translate(xpl_context_t* _s, xpl_instr_t* _c, int _l, const char* _n, FILE* _fp);
+/**
+ * @brief Runs a 'then' for translated code.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _t - Keyword function which the untaken branch stops at.
+ * @return - Returns non-zero if the branch is taken.
+ */
+XPLAPI int xpl_aot_then(xpl_context_t* _s, xpl_func_t _t);
+/**
+ * @brief Runs an 'elseif' or 'else' reached after a taken branch for
+ *  translated code, the 'if' statement ends if no lane remains.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _f - Keyword function.
+ * @return - Returns non-zero if the rest branches go on.
+ */
+XPLAPI int xpl_aot_branch(xpl_context_t* _s, xpl_func_t _f);
+
+/**
+ * @brief Skips a piece of comment.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s);
+/**
+ * @brief Determines whether there's a parameter in current XPL context at
+ *  cursor point.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status, XS_OK if there's a parameter, or
+ *  XS_NO_PARAM if not.
+ */
+XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s);
+/**
+ * @brief Skips a string parameter from XPL context.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status, XS_OK if succeed.
+ */
+XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s);
+/**
+ * @brief Pops a long integer parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_long(xpl_context_t* _s, long* _o);
+/**
+ * @brief Pops a 64-bit signed integer parameter from XPL context, decimal,
+ *  hexadecimal (0x), binary (0b) and octal (0) literals are accepted.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_int64(xpl_context_t* _s, xpl_int64_t* _o);
+/**
+ * @brief Pops a 64-bit unsigned integer parameter from XPL context, decimal,
+ *  hexadecimal (0x), binary (0b) and octal (0) literals are accepted.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_uint64(xpl_context_t* _s, xpl_uint64_t* _o);
+/**
+ * @brief Pops a double float parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o);
+/**
+ * @brief Pops a string parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @param[in] _l  - Destination buffer size.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l);
+/**
+ * @brief Pops a string parameter from XPL context as a view without copying.
+ *  The view points into script source text for an unquoted string or a
+ *  quoted string without escape; otherwise the string is decoded into the
+ *  fallback buffer and the view points to that buffer.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination view.
+ * @param[in] _b  - Fallback buffer for escaped string, could be NULL.
+ * @param[in] _l  - Fallback buffer size.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_string_view(xpl_context_t* _s, xpl_string_view_t* _o, char* _b, int _l);
+/**
+ * @brief Sets the backing buffer of the scratch arena of XPL context.
+ *  Allocations from the arena are valid until the next step.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _b - Backing buffer, NULL to detach.
+ * @param[in] _l - Backing buffer size.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_set_scratch(xpl_context_t* _s, char* _b, int _l);
+/**
+ * @brief Allocates from the scratch arena of XPL context, aligned to
+ *  double relative to the backing buffer.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _n  - Bytes to allocate.
+ * @param[out] _o - Allocated memory.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_scratch_alloc(xpl_context_t* _s, int _n, void** _o);
+/**
+ * @brief Pops a string parameter of any length from XPL context as a view.
+ *  Like xpl_pop_string_view, but an escaped string is decoded into the
+ *  scratch arena with a terminator, so it is only bounded by the arena.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination view, valid until the next step.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_string_scratch(xpl_context_t* _s, xpl_string_view_t* _o);
+/**
+ * @brief Buildin escape determination functor, a backslash begins an escape.
+ *  Assigning it with xpl_parse_escape to a context turns on the buildin
+ *  escape mode, which scans quoted strings in bulk and only decodes at
+ *  escape points; other functors are called per char as a custom dialect.
+ *
+ * @param[in] _c - Charactor to be determinated.
+ * @return - Returns non-zero if escape determinated.
+ */
+XPLAPI int xpl_is_backslash(unsigned char _c);
+/**
+ * @brief Buildin escape parser of JSON escapes, \uXXXX and surrogate pairs
+ *  are encoded as UTF-8.
+ *
+ * @param[in] _d - Pointer to destination buffer.
+ * @param[in] _s - Pointer to source buffer, at the backslash.
+ * @return - Returns parsed escape charactor count.
+ */
+XPLAPI int xpl_parse_escape(char** _d, const char** _s);
+/**
+ * @brief Pushes a boolean value to XPL context.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _b - Boolean value.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b);
+/**
+ * @brief Pushes a boolean value per lane to XPL context, bits of inactive
+ *  lanes are ignored.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _m - Mask of lanes which are true.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_push_lanes(xpl_context_t* _s, xpl_lanes_t _m);
+/**
+ * @brief Sets count of batch lanes, 1 by default. A script runs once for
+ *  all lanes, branch bodies run with the lanes whose condition is true.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _n - Count of lanes, up to XPL_MAX_LANES.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_set_lanes(xpl_context_t* _s, int _n);
+/**
+ * @brief Gets lanes running current statement.
+ *
+ * @param[in] _s - XPL context.
+ * @param[out] _m - Mask of active lanes.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_active_lanes(xpl_context_t* _s, xpl_lanes_t* _m);
+/**
+ * @brief Invalidates cached results of pure predicates, they are also
+ *  invalidated when loading or reloading a script.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_memo_bump(xpl_context_t* _s);
+
+/**
+ * @brief Opens a cooperative scheduler.
+ *
+ * @param[in] _c - Scheduler.
+ * @param[in] _a - Pointer to context array.
+ * @param[in] _l - Capacity of the context array.
+ * @param[in] _d - Completion callback, could be NULL.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_scheduler_open(xpl_scheduler_t* _c, xpl_context_t** _a, int _l, xpl_scheduler_done_func _d);
+/**
+ * @brief Adds a context with script loaded to a scheduler.
+ *
+ * @param[in] _c - Scheduler.
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_scheduler_add(xpl_scheduler_t* _c, xpl_context_t* _s);
+/**
+ * @brief Resumes every scheduled context once, until it yields, runs out of
+ *  budget or ends; ended contexts are removed.
+ *
+ * @param[in] _c - Scheduler.
+ * @return - Returns XS_SUSPENT if any context remains, otherwise XS_OK.
+ */
+XPLAPI xpl_status_t xpl_scheduler_tick(xpl_scheduler_t* _c);
+/**
+ * @brief Ticks a scheduler until all contexts ended.
+ *
+ * @param[in] _c - Scheduler.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_scheduler_run(xpl_scheduler_t* _c);
+
+#ifdef XPL_ENABLE_PROFILER
+/**
+ * @brief Opens a profile.
+ *
+ * @param[in] _p - Profile.
+ * @param[in] _r - Registry of profiled contexts.
+ * @param[in] _f - Pointer to interface counters, one per registered interface.
+ * @param[in] _b - Pointer to branch counters.
+ * @param[in] _l - Count of branch counters, branches beyond are not counted.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_profile_open(xpl_profile_t* _p, const xpl_registry_t* _r, xpl_prof_func_t* _f, xpl_prof_branch_t* _b, int _l);
+/**
+ * @brief Attaches a profile to a context, or detaches with NULL.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _p - Profile, opened with the registry of the context.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_profile_attach(xpl_context_t* _s, xpl_profile_t* _p);
+/**
+ * @brief Resets all counters of a profile.
+ *
+ * @param[in] _p - Profile.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_profile_reset(xpl_profile_t* _p);
+/**
+ * @brief Gets counters of an interface.
+ *
+ * @param[in] _p - Profile.
+ * @param[in] _n - Interface name.
+ * @param[out] _o - Counters of the interface.
+ * @return - Returns execution status, XS_ERR if not registered.
+ */
+XPLAPI xpl_status_t xpl_profile_get(xpl_profile_t* _p, const char* _n, xpl_prof_func_t* _o);
+/**
+ * @brief Dumps all counters of a profile.
+ *
+ * @param[in] _p - Profile.
+ * @param[in] _fp - Output file.
+ * @param[in] _f - Dumping format.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_profile_dump(xpl_profile_t* _p, FILE* _fp, xpl_prof_format_t _f);
+#endif /* XPL_ENABLE_PROFILER */
+
+#ifdef XPL_ENABLE_TRACE
+/**
+ * @brief Opens a trace ring, without waiting for any calibration; the rate
+ *  of a cycle counter is measured between opening and exporting.
+ *
+ * @param[in] _r - Trace ring.
+ * @param[in] _e - Pointer to event buffer.
+ * @param[in] _l - Capacity of event buffer, must be a power of 2.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_trace_open(xpl_trace_ring_t* _r, xpl_trace_event_t* _e, int _l);
+/**
+ * @brief Attaches a trace ring to a context, or detaches with NULL.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _r - Trace ring.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_trace_attach(xpl_context_t* _s, xpl_trace_ring_t* _r);
+/**
+ * @brief Pops the oldest event of a trace ring, by the consumer.
+ *
+ * @param[in] _r - Trace ring.
+ * @param[out] _e - Popped event.
+ * @return - Returns execution status, XS_ERR if empty.
+ */
+XPLAPI xpl_status_t xpl_trace_pop(xpl_trace_ring_t* _r, xpl_trace_event_t* _e);
+/**
+ * @brief Pops all events of a trace ring and writes them as Chrome trace
+ *  event JSON, by the consumer.
+ *
+ * @param[in] _r - Trace ring.
+ * @param[in] _g - Registry of the traced context.
+ * @param[in] _fp - Output file.
+ * @param[in] _tid - Thread id shown in the trace.
+ * @param[in] _t - Ticks per microsecond, if not positive the rate of the
+ *  clock is used, or a cycle counter is measured against the reference
+ *  clock since the ring was opened.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_trace_export(xpl_trace_ring_t* _r, const xpl_registry_t* _g, FILE* _fp, int _tid, double _t);
+#endif /* XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_POOL
+/**
+ * @brief Opens a worker pool. Each worker gets a copy of an opened prototype
+ *  context, so interfaces are sorted only once and shared read-only.
+ *
+ * @param[in] _p - Worker pool.
+ * @param[in] _s - Opened prototype context without script loaded.
+ * @param[in] _w - Pointer to worker array.
+ * @param[in] _n - Count of workers.
+ * @param[in] _a - Pins worker threads to cores if non-zero, where the platform
+ *  supports it, e.g. _GNU_SOURCE is required on Linux.
+ * @param[in] _d - Job completion callback, could be NULL.
+ * @return - Returns execution status, XS_ERR if a worker thread failed to
+ *  start, then the started ones are stopped and the pool is closed.
+ */
+XPLAPI xpl_status_t xpl_pool_open(xpl_pool_t* _p, const xpl_context_t* _s, xpl_worker_t* _w, int _n, int _a, xpl_job_done_func _d);
+/**
+ * @brief Closes a worker pool after queued jobs completed.
+ *
+ * @param[in] _p - Worker pool.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pool_close(xpl_pool_t* _p);
+/**
+ * @brief Submits a job to a worker pool, the job must stay alive until
+ *  completed.
+ *
+ * @param[in] _p - Worker pool.
+ * @param[in] _j - Job to be run.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pool_submit(xpl_pool_t* _p, xpl_job_t* _j);
+/**
+ * @brief Waits until all submitted jobs of a worker pool completed.
+ *
+ * @param[in] _p - Worker pool.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pool_wait(xpl_pool_t* _p);
+#endif /* XPL_ENABLE_POOL */
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+/**
+ * @brief Opens a script cache, usually one per process shared by threads.
+ *
+ * @param[in] _c - Script cache.
+ * @param[in] _m - Memory cap in bytes, entries in use are never evicted.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_script_cache_open(xpl_script_cache_t* _c, size_t _m);
+/**
+ * @brief Closes a script cache, every context must have unloaded its cached
+ *  script before.
+ *
+ * @param[in] _c - Script cache.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_script_cache_close(xpl_script_cache_t* _c);
+/**
+ * @brief Loads a script through a script cache. Identical text loaded with
+ *  the same registry and functors reuses the prepared script, otherwise the
+ *  script is copied, compiled with literals and cached. The context runs the
+ *  cached copy by xpl_run_compiled, so the text could be released after.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _c - Script cache.
+ * @param[in] _t - Script text.
+ * @param[in] _l - Length of script text.
+ * @return - Returns execution status, the text stays loaded uncompiled if it
+ *  failed to compile or to allocate.
+ */
+XPLAPI xpl_status_t xpl_load_cached(xpl_context_t* _s, xpl_script_cache_t* _c, const char* _t, size_t _l);
+/**
+ * @brief Gets the counters of a script cache.
+ *
+ * @param[in] _c  - Script cache.
+ * @param[out] _o - Counters.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_script_cache_stats(xpl_script_cache_t* _c, xpl_script_cache_stats_t* _o);
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
 /**
  * @brief Scripting programming interface:
- *   'if' statement, dummy function.
+ *   'if' statement, pushes an 'if' frame.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -372,7 +1600,8 @@ XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b);
 XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s);
 /**
  * @brief Scripting programming interface:
- *   'then' statement, main logic about 'if-then-elseif-else-endif'.
+ *   'then' statement, enters a branch if the condition is true, otherwise
+ *   skips to the next branch.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -380,7 +1609,8 @@ XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s);
 XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s);
 /**
  * @brief Scripting programming interface:
- *   'elseif' statement, dummy function.
+ *   'elseif' statement, reached after a taken branch, evaluates its condition
+ *   for lanes which haven't taken a branch, or skips to 'endif'.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -388,7 +1618,8 @@ XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s);
 XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s);
 /**
  * @brief Scripting programming interface:
- *   'else' statement, dummy function.
+ *   'else' statement, reached after a taken branch, runs for lanes which
+ *   haven't taken a branch, or skips to 'endif'.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -396,7 +1627,7 @@ XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s);
 XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s);
 /**
  * @brief Scripting programming interface:
- *   'endif' statement, dummy function.
+ *   'endif' statement, pops an 'if' frame.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -404,7 +1635,8 @@ XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s);
 XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s);
 /**
  * @brief Scripting programming interface:
- *   'or' statement, set current boolean composing type as OR.
+ *   'or' statement, set current boolean composing type as OR, skips the
+ *   next predicate if current boolean value is already true.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -412,7 +1644,8 @@ XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s);
 XPLINTERNAL xpl_status_t _xpl_core_or(xpl_context_t* _s);
 /**
  * @brief Scripting programming interface:
- *   'and' statement, set current boolean composing type as AND.
+ *   'and' statement, set current boolean composing type as AND, skips the
+ *   next predicate if current boolean value is already false.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
@@ -428,52 +1661,478 @@ XPLINTERNAL xpl_status_t _xpl_core_and(xpl_context_t* _s);
 XPLINTERNAL xpl_status_t _xpl_core_yield(xpl_context_t* _s);
 
 /**
- * @brief Skips execution body of an 'if' statement.
+ * @brief Skips execution body of an 'if' statement, stops at the next
+ *  'elseif', 'else' or 'endif' of the same level.
  *
  * @param[in] _s - XPL context.
+ * @return - Returns zero if preempted by execution budget.
  */
-XPLINTERNAL void _xpl_skip_ifcond_body(xpl_context_t* _s);
-
+XPLINTERNAL int _xpl_skip_ifcond_body(xpl_context_t* _s);
 /**
- * @brief Determines whether a char is a single quote.
+ * @brief Skips rest branches of an 'if' statement after a branch keyword,
+ *  stops after its 'endif'.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_is_squote(unsigned char _c);
+XPLINTERNAL xpl_status_t _xpl_skip_to_endif(xpl_context_t* _s);
 /**
- * @brief Determines whether a char is a double quote.
+ * @brief Resumes pending branch skipping.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_is_dquote(unsigned char _c);
+XPLINTERNAL xpl_status_t _xpl_skip_resume(xpl_context_t* _s);
 /**
- * @brief Determines whether a char is a comma.
+ * @brief Consumes a unit of execution budget.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s - XPL context.
+ * @return - Returns non-zero if budget ran out.
  */
-XPLINTERNAL int _xpl_is_comma(unsigned char _c);
+XPLINTERNAL int _xpl_budget_out(xpl_context_t* _s);
 /**
- * @brief Determines whether a char is an exclamation.
+ * @brief Runs current script or compiled program within execution budget.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_is_exclamation(unsigned char _c);
+XPLINTERNAL xpl_status_t _xpl_run_budgeted(xpl_context_t* _s);
 /**
- * @brief Determines whether a char is a colon.
+ * @brief Maps a file for reading.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _p  - File path.
+ * @param[in] _a  - Access pattern hint.
+ * @param[out] _v - Mapped view, NULL if the file is empty.
+ * @param[out] _l - Size of the mapped view.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_is_colon(unsigned char _c);
+XPLINTERNAL xpl_status_t _xpl_map_file(const char* _p, xpl_access_hint_t _a, void** _v, size_t* _l);
 /**
- * @brief Determines whether a char is a blank.
+ * @brief Unmaps a mapped view, does nothing if NULL.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _v - Mapped view.
+ * @param[in] _l - Size of the mapped view.
+ */
+XPLINTERNAL void _xpl_unmap_file(void* _v, size_t _l);
+/**
+ * @brief Fills the expected header of a compiled image of current script.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _h - Image header.
+ */
+XPLINTERNAL void _xpl_image_header(xpl_context_t* _s, xpl_image_header_t* _h);
+/**
+ * @brief Gets the offset of literals in a compiled image.
+ *
+ * @param[in] _n - Count of instructions.
+ * @return - Returns offset from the beginning of the image.
+ */
+XPLINTERNAL size_t _xpl_image_literals_at(int _n);
+/**
+ * @brief Determines whether translated code needs a label before an
+ *  instruction.
+ *
+ * @param[in] _f - Pointer to registered interfaces.
+ * @param[in] _c - Pointer to compiled instructions.
+ * @param[in] _n - Count of compiled instructions.
+ * @param[in] _j - Instruction index, equals to _n for the end.
+ * @return - Returns non-zero if the label is jumped to or resumed at.
+ */
+XPLINTERNAL int _xpl_translate_label(const xpl_func_info_t* _f, const xpl_instr_t* _c, int _n, int _j);
+/**
+ * @brief Writes a piece of text as C string literals.
+ *
+ * @param[in] _fp - Output file.
+ * @param[in] _t  - Text to be written.
+ * @param[in] _e  - End of the text.
+ */
+XPLINTERNAL void _xpl_translate_text(FILE* _fp, const char* _t, const char* _e);
+/**
+ * @brief Gets a cached branch skipping target.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _k  - Skipping start key.
+ * @param[out] _t - Target offset in source text.
+ * @return - Returns non-zero if cached.
+ */
+XPLINTERNAL int _xpl_branch_cache_get(xpl_context_t* _s, int _k, int* _t);
+/**
+ * @brief Caches a branch skipping target.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _k - Skipping start key.
+ * @param[in] _t - Target offset in source text.
+ */
+XPLINTERNAL void _xpl_branch_cache_set(xpl_context_t* _s, int _k, int _t);
+/**
+ * @brief Determines whether composing more predicates can't change current
+ *  boolean value.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns non-zero if the value is known.
+ */
+XPLINTERNAL int _xpl_bool_known(xpl_context_t* _s);
+/**
+ * @brief Determines whether an interface could be skipped by short circuit
+ *  evaluation, that is neither a keyword nor marked with side effect.
+ *
+ * @param[in] _f - Interface information.
+ * @return - Returns non-zero if skippable.
+ */
+XPLINTERNAL int _xpl_func_skippable(const xpl_func_info_t* _f);
+/**
+ * @brief Skips a predicate with its parameters at cursor point if it's
+ *  skippable.
+ *
+ * @param[in] _s - XPL context.
+ */
+XPLINTERNAL void _xpl_skip_predicate(xpl_context_t* _s);
+/**
+ * @brief Calls a pure predicate at cursor point, or pushes its cached result
+ *  without calling. An unknown parameter end is looked up by call site in
+ *  the branch cache first, parameters are scanned only on a miss.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _f - Predicate interface.
+ * @param[in] _e - End of its parameters, NULL if not scanned yet.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_call_pure(xpl_context_t* _s, const xpl_func_info_t* _f, const char* _e);
+/**
+ * @brief Calls an interface at cursor point, through the result cache if
+ *  it's a pure predicate of a script not streamed.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _f - Interface.
+ * @param[in] _e - End of its parameters, NULL if not scanned yet.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_call(xpl_context_t* _s, const xpl_func_info_t* _f, const char* _e);
+
+/**
+ * @brief Refills the window of a streamed script if lookahead runs short,
+ *  consumed text before cursor is discarded.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _f - Fills the whole window if non-zero, otherwise refills only
+ *  when less than half of the window is left.
+ */
+XPLINTERNAL void _xpl_stream_fill(xpl_context_t* _s, int _f);
+/**
+ * @brief Refills the window of a streamed script and skips meaningless parts
+ *  across window boundaries, does nothing if not streaming.
+ *
+ * @param[in] _s - XPL context.
+ */
+XPLINTERNAL void _xpl_stream_sync(xpl_context_t* _s);
+/**
+ * @brief Makes sure the statement at cursor of a streamed script, an
+ *  interface with its parameters, is entirely in the window, refills the
+ *  whole window once if it reaches the window end before the stream end.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns XS_NO_ENOUGH_BUFFER_SIZE if the statement is longer than
+ *  the window, otherwise execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_stream_statement(xpl_context_t* _s);
+/**
+ * @brief Determines whether there's more script text to be run.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns non-zero if there's more.
+ */
+XPLINTERNAL int _xpl_has_more(xpl_context_t* _s);
+
+#if defined(XPL_ENABLE_PROFILER) || defined(XPL_ENABLE_TRACE)
+/**
+ * @brief Reads a monotonic cycle counter, or the finest monotonic clock.
+ *
+ * @return - Returns current ticks.
+ */
+XPLINTERNAL xpl_uint64_t _xpl_ticks(void);
+/**
+ * @brief Writes a string as a quoted JSON string, with quotes, backslashes
+ *  and control characters escaped.
+ *
+ * @param[in] _fp - Output file.
+ * @param[in] _t  - String to be written.
+ */
+XPLINTERNAL void _xpl_write_json_string(FILE* _fp, const char* _t);
+#endif /* XPL_ENABLE_PROFILER || XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_TRACE
+/**
+ * @brief Gets the rate of _xpl_ticks if the clock tells it.
+ *
+ * @return - Returns ticks per microsecond, zero for a cycle counter.
+ */
+XPLINTERNAL double _xpl_ticks_per_us(void);
+/**
+ * @brief Reads the reference clock a cycle counter is measured against, a
+ *  monotonic clock, or the processor clock if there is none.
+ *
+ * @return - Returns current time in microseconds.
+ */
+XPLINTERNAL double _xpl_ref_us(void);
+#endif /* XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_PROFILER
+/**
+ * @brief Calls an interface and counts it in the attached profile.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _f - Interface.
+ * @param[in] _e - End of its parameters, NULL if not scanned yet.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_profile_call(xpl_context_t* _s, const xpl_func_info_t* _f, const char* _e);
+/**
+ * @brief Counts a 'then' branch in the attached profile.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _o - Source offset of the branch body.
+ * @param[in] _t - Non-zero if taken.
+ */
+XPLINTERNAL void _xpl_profile_branch(xpl_context_t* _s, int _o, int _t);
+#endif /* XPL_ENABLE_PROFILER */
+
+#ifdef XPL_ENABLE_TRACE
+/**
+ * @brief Emits an event to the attached trace ring, drops it if full.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _k - Event kind.
+ * @param[in] _f - Interface, could be NULL.
+ * @param[in] _o - Cursor offset in source text.
+ * @param[in] _r - Returned status.
+ */
+XPLINTERNAL void _xpl_trace_emit(xpl_context_t* _s, xpl_trace_kind_t _k, const xpl_func_info_t* _f, int _o, xpl_status_t _r);
+#endif /* XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_POOL
+/**
+ * @brief Takes a job for a worker, from its own queue head first, then
+ *  steals from tails of the others.
+ *
+ * @param[in] _w - Pool worker.
+ * @return - Returns taken job, or NULL if none.
+ */
+XPLINTERNAL xpl_job_t* _xpl_pool_take(xpl_worker_t* _w);
+/**
+ * @brief Runs a job on the context of a worker.
+ *
+ * @param[in] _w - Pool worker.
+ * @param[in] _j - Job to be run.
+ */
+XPLINTERNAL void _xpl_pool_run(xpl_worker_t* _w, xpl_job_t* _j);
+/**
+ * @brief Pins the calling worker thread to a core.
+ *
+ * @param[in] _w - Pool worker.
+ */
+XPLINTERNAL void _xpl_pool_pin(xpl_worker_t* _w);
+/**
+ * @brief Main loop of a worker thread.
+ *
+ * @param[in] _w - Pool worker.
+ */
+XPLINTERNAL void _xpl_pool_loop(xpl_worker_t* _w);
+/**
+ * @brief Entry of a worker thread.
+ *
+ * @param[in] _w - Pool worker.
+ */
+#if defined(_WIN32)
+XPLINTERNAL DWORD WINAPI _xpl_pool_entry(LPVOID _w);
+#else
+XPLINTERNAL void* _xpl_pool_entry(void* _w);
+#endif
+#endif /* XPL_ENABLE_POOL */
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+/**
+ * @brief Hashes script text a word at a time.
+ *
+ * @param[in] _t - Script text.
+ * @param[in] _l - Length of script text.
+ * @return - Returns hash value.
+ */
+XPLINTERNAL xpl_uint64_t _xpl_hash_text(const char* _t, size_t _l);
+/**
+ * @brief Finds a prepared script matching a context and touches it, the
+ *  cache lock must be held.
+ *
+ * @param[in] _c - Script cache.
+ * @param[in] _s - XPL context.
+ * @param[in] _h - Hash of script text.
+ * @param[in] _t - Script text.
+ * @param[in] _l - Length of script text.
+ * @return - Returns found prepared script, or NULL if not found.
+ */
+XPLINTERNAL xpl_prepared_t* _xpl_prepared_find(xpl_script_cache_t* _c, xpl_context_t* _s, xpl_uint64_t _h, const char* _t, size_t _l);
+/**
+ * @brief Prepares the script loaded in a context without the cache lock.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _c  - Script cache.
+ * @param[in] _h  - Hash of script text.
+ * @param[out] _o - Prepared script with no reference.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_prepare(xpl_context_t* _s, xpl_script_cache_t* _c, xpl_uint64_t _h, xpl_prepared_t** _o);
+/**
+ * @brief Removes a prepared script from its cache, the cache lock must be
+ *  held.
+ *
+ * @param[in] _c - Script cache.
+ * @param[in] _p - Prepared script.
+ */
+XPLINTERNAL void _xpl_prepared_unlink(xpl_script_cache_t* _c, xpl_prepared_t* _p);
+/**
+ * @brief Evicts least recently used prepared scripts not in use until the
+ *  memory cap is met, the cache lock must be held.
+ *
+ * @param[in] _c - Script cache.
+ */
+XPLINTERNAL void _xpl_script_cache_trim(xpl_script_cache_t* _c);
+/**
+ * @brief Releases a reference of a prepared script.
+ *
+ * @param[in] _p - Prepared script.
+ */
+XPLINTERNAL void _xpl_prepared_release(xpl_prepared_t* _p);
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+/**
+ * @brief Pops a string parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @param[in] _l  - Destination buffer size.
+ * @param[out] _n - Count of popped chars, terminator excluded.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_pop_string(xpl_context_t* _s, char* _o, int _l, int* _n);
+/**
+ * @brief Pre-parses the parameter at cursor, and skips it.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _v - Parsed literal.
+ */
+XPLINTERNAL void _xpl_literal_parse(xpl_context_t* _s, xpl_literal_t* _v);
+/**
+ * @brief Gets the pre-parsed literal at cursor.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns found literal, or NULL if not parsed.
+ */
+XPLINTERNAL const xpl_literal_t* _xpl_literal_at(xpl_context_t* _s);
+/**
+ * @brief Determines whether the buildin escape mode is on.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns non-zero if both escape functors are buildin.
+ */
+XPLINTERNAL int _xpl_is_builtin_escape(const xpl_context_t* _s);
+/**
+ * @brief Decodes a buildin escape.
+ *
+ * @param[in] _d - Pointer to destination buffer, 4 chars at most are written.
+ * @param[in] _s - Pointer to source buffer, at the backslash.
+ * @param[in] _e - End of source buffer, NULL if terminated.
+ * @return - Returns parsed escape charactor count, 0 if bad format.
+ */
+XPLINTERNAL int _xpl_decode_escape(char** _d, const char** _s, const char* _e);
+/**
+ * @brief Parses 4 hexadecimal digits.
+ *
+ * @param[in] _p  - Digits to be parsed.
+ * @param[in] _e  - End of the digits, NULL if terminated.
+ * @param[out] _o - Parsed value.
+ * @return - Returns non-zero if succeed.
+ */
+XPLINTERNAL int _xpl_parse_hex4(const char* _p, const char* _e, unsigned* _o);
+
+/**
+ * @brief Locates a number parameter at cursor, a quoted number is accepted.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _b - Beginning of the number.
+ * @param[out] _e - End of the number.
+ * @return - Returns cursor after the parameter.
+ */
+XPLINTERNAL const char* _xpl_number_token(xpl_context_t* _s, const char** _b, const char** _e);
+/**
+ * @brief Parses an integer in place, independent to locale.
+ *
+ * @param[in] _b    - Beginning of the number.
+ * @param[in] _e    - End of the number.
+ * @param[out] _o   - Absolute value.
+ * @param[out] _neg - Non-zero if negative.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_parse_integer(const char* _b, const char* _e, xpl_uint64_t* _o, int* _neg);
+/**
+ * @brief Parses a real number in place, independent to locale; numbers which
+ *  can't be parsed exactly in place fall back to _xpl_parse_double_strtod.
+ *
+ * @param[in] _b  - Beginning of the number.
+ * @param[in] _e  - End of the number.
+ * @param[out] _o - Parsed value.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_parse_double(const char* _b, const char* _e, double* _o);
+/**
+ * @brief Parses a real number with strtod, each '.' is replaced with the
+ *  decimal point of current locale, which could be more than one char.
+ *
+ * @param[in] _b  - Beginning of the number.
+ * @param[in] _e  - End of the number.
+ * @param[out] _o - Parsed value.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_parse_double_strtod(const char* _b, const char* _e, double* _o);
+
+/**
+ * @brief Determines whether a char is a single quote.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_squote(unsigned char _c);
+/**
+ * @brief Determines whether a char is a double quote.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_dquote(unsigned char _c);
+/**
+ * @brief Determines whether a char is a comma.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_comma(unsigned char _c);
+/**
+ * @brief Determines whether a char is an exclamation.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_exclamation(unsigned char _c);
+/**
+ * @brief Determines whether a char is a colon.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_colon(unsigned char _c);
+/**
+ * @brief Determines whether a char is a blank.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
  */
 XPLINTERNAL int _xpl_is_blank(unsigned char _c);
 /**
@@ -485,12 +2144,62 @@ XPLINTERNAL int _xpl_is_blank(unsigned char _c);
  */
 XPLINTERNAL int _xpl_is_separator(unsigned char _c, xpl_is_separator_func _is);
 /**
- * @brief Trims extra chars.
+ * @brief Builds a character class table.
+ *
+ * @param[out] _cc - Character class table.
+ * @param[in] _is  - Separator determination functor.
+ */
+XPLINTERNAL void _xpl_build_char_class(unsigned char* _cc, xpl_is_separator_func _is);
+/**
+ * @brief Counts trailing zero bits.
+ *
+ * @param[in] _m - Non-zero mask.
+ * @return - Returns index of the lowest set bit.
+ */
+XPLINTERNAL unsigned _xpl_ctz(unsigned _m);
+/**
+ * @brief Scans for a char in bulk.
+ *
+ * @param[in] _p - String to be scanned.
+ * @param[in] _e - End of the string.
+ * @param[in] _c - Char to be found.
+ * @return - Returns pointer to the first matching char, terminator or end.
+ */
+XPLINTERNAL const char* _xpl_scan_char(const char* _p, const char* _e, char _c);
+/**
+ * @brief Scans for either of two chars in bulk.
+ *
+ * @param[in] _p - String to be scanned.
+ * @param[in] _e - End of the string.
+ * @param[in] _c - Char to be found.
+ * @param[in] _d - Another char to be found.
+ * @return - Returns pointer to the first matching char, terminator or end.
+ */
+XPLINTERNAL const char* _xpl_scan_chars(const char* _p, const char* _e, char _c, char _d);
+/**
+ * @brief Skips blank chars in bulk.
  *
- * @param[in][out] - String to be trimmed.
- * @return - Returns count of trimmed chars.
+ * @param[in] _p - String to be scanned.
+ * @param[in] _e - End of the string.
+ * @return - Returns pointer to the first non-blank char or end.
  */
-XPLINTERNAL int _xpl_trim(const char** _c);
+XPLINTERNAL const char* _xpl_skip_blank(const char* _p, const char* _e);
+/**
+ * @brief Scans for a buildin separator in bulk.
+ *
+ * @param[in] _p - String to be scanned.
+ * @param[in] _e - End of the string.
+ * @return - Returns pointer to the first separator, terminator or end.
+ */
+XPLINTERNAL const char* _xpl_scan_separator(const char* _p, const char* _e);
+/**
+ * @brief Scans for the end of a token, customized separators included.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _p - String to be scanned.
+ * @return - Returns pointer to the first separator, terminator or end.
+ */
+XPLINTERNAL const char* _xpl_scan_token_end(xpl_context_t* _s, const char* _p);
 /**
  * @brief Compires two strings.
  *
@@ -500,191 +2209,2317 @@ XPLINTERNAL int _xpl_trim(const char** _c);
  */
 XPLINTERNAL int _xpl_strcmp(const char* _s, const char* _d);
 /**
- * @brief Compires scripting programming interface information in quick
- *  sorting.
+ * @brief Hashes a separator terminated token.
  *
- * @param[in] _l - First interface information.
- * @param[in] _r - Second interface information.
- * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ * @param[in] _cc - Character class table.
+ * @param[in] _t  - Token to be hashed.
+ * @param[in] _e  - End of text, NULL if terminated only.
+ * @param[out] _l - Length of the token.
+ * @return - Returns hash value.
+ */
+XPLINTERNAL unsigned _xpl_hash(const unsigned char* _cc, const char* _t, const char* _e, int* _l);
+/**
+ * @brief Finds a scripting programming interface by a token in a single pass.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _t - Token to be found.
+ * @return - Returns found interface, or NULL if not found.
+ */
+XPLINTERNAL const xpl_func_info_t* _xpl_find_func(xpl_context_t* _s, const char* _t);
+/**
+ * @brief Tries to peek one function, as xpl_peek_func with a read-only
+ *  interface of the registry.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _f - Peeked interface, NULL if none.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_peek_func(xpl_context_t* _s, const xpl_func_info_t** _f);
+/**
+ * @brief Gets the slot of a hash value displaced in a perfect hash.
+ *
+ * @param[in] _h - Hash value.
+ * @param[in] _d - Displacement of the bucket of the hash value.
+ * @return - Returns slot index.
  */
-XPLINTERNAL int _xpl_func_info_srt_cmp(const void* _l, const void* _r);
+XPLINTERNAL int _xpl_perfect_slot(unsigned _h, unsigned _d);
 /**
- * @brief Compires scripting programming interface information in binary
- *  searching.
+ * @brief Compires scripting programming interface information by hash in
+ *  quick sorting.
  *
- * @param[in] _k - Searching key.
- * @param[in] _i - Interface information.
- * @return - Returns 1 if _k > _i, -1 if _k < _i, 0 if _k = _i.
+ * @param[in] _l - First interface information.
+ * @param[in] _r - Second interface information.
+ * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
  */
-XPLINTERNAL int _xpl_func_info_sch_cmp(const void* _k, const void* _i);
+XPLINTERNAL int _xpl_func_info_hash_cmp(const void* _l, const void* _r);
+
+/* ========================================================} */
+
+/*
+** {========================================================
+** Function definitions
+*/
+
+XPLAPI xpl_status_t xpl_registry_build(xpl_registry_t* _r, xpl_func_info_t* _f) {
+  int i = 0;
+  int j = 0;
+  xpl_assert(_r && _f);
+  memset(_r, 0, sizeof(xpl_registry_t));
+  _xpl_build_char_class(_r->char_class, NULL);
+  _r->funcs = _f;
+  while(_f[_r->funcs_count].name && _f[_r->funcs_count].func)
+    _r->funcs_count++;
+  if(!(_f[_r->funcs_count].flags & XFF_SORTED)) {
+    for(i = 0; i < _r->funcs_count; i++)
+      _f[i].hash = _xpl_hash(_r->char_class, _f[i].name, NULL, &_f[i].length);
+    qsort(_f, _r->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_hash_cmp);
+    _f[_r->funcs_count].flags |= XFF_SORTED;
+  }
+  for(i = 0, j = 0; i <= (1 << XPL_DISPATCH_BITS); i++) {
+    while(j < _r->funcs_count && (int)(_f[j].hash >> (32 - XPL_DISPATCH_BITS)) < i)
+      j++;
+    _r->dispatch[i] = j;
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_registry_build_perfect(xpl_registry_t* _r, const xpl_func_info_t* _f, unsigned _m, const int* _d) {
+  xpl_assert(_r && _f && (_m & 1) && _d);
+  memset(_r, 0, sizeof(xpl_registry_t));
+  _xpl_build_char_class(_r->char_class, NULL);
+  _r->funcs = _f;
+  while(_f[_r->funcs_count].name && _f[_r->funcs_count].func)
+    _r->funcs_count++;
+  memcpy(_r->dispatch, _d, sizeof(int) << XPL_DISPATCH_BITS);
+  _r->dispatch[1 << XPL_DISPATCH_BITS] = -1;
+  _r->seed = _m;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_func_info_t* _f, xpl_is_separator_func _is) {
+  xpl_registry_t* reg = NULL;
+  xpl_assert(_s && _f);
+  memset(_s, 0, sizeof(xpl_context_t));
+  reg = (xpl_registry_t*)XPL_MALLOC(sizeof(xpl_registry_t));
+  if(!reg) return XS_ERR;
+  xpl_registry_build(reg, _f);
+  xpl_open_registry(_s, reg, _is);
+  _s->own_registry = reg;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_open_registry(xpl_context_t* _s, const xpl_registry_t* _r, xpl_is_separator_func _is) {
+  xpl_assert(_s && _r && _r->funcs);
+  memset(_s, 0, sizeof(xpl_context_t));
+  _s->registry = _r;
+  _s->separator_detect = _is;
+  if(_is) _xpl_build_char_class(_s->char_class, _is);
+  else memcpy(_s->char_class, _r->char_class, sizeof(_s->char_class));
+  _s->lanes = _s->active_lanes = 1;
+  _s->memo_epoch = 1;
+  _s->budget = -1;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_close(xpl_context_t* _s) {
+  xpl_assert(_s);
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+  if(_s->prepared) _xpl_prepared_release(_s->prepared);
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+  if(_s->own_registry) XPL_FREE(_s->own_registry);
+  memset(_s, 0, sizeof(xpl_context_t));
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t) {
+  xpl_assert(_s && _t);
+
+  return xpl_load_n(_s, _t, strlen(_t));
+}
+
+XPLAPI xpl_status_t xpl_load_n(xpl_context_t* _s, const char* _t, size_t _l) {
+  xpl_assert(_s && _t);
+  if(_s->text) xpl_unload(_s);
+  _s->cursor = _s->text = _t;
+  _s->text_end = _t + _l;
+  _s->pc = 0;
+  _s->literal = 0;
+  _s->if_statement_depth = 0;
+  _s->active_lanes = _s->lanes;
+  _s->bool_value = 0;
+  _s->bool_composing = XBC_NIL;
+  _s->skip_kind = XSK_NONE;
+  _s->skip_body = 0;
+  _s->memo_epoch++;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_load_file(xpl_context_t* _s, const char* _p, xpl_access_hint_t _a) {
+  void* view = NULL;
+  size_t size = 0;
+  xpl_assert(_s && _p);
+  if(_s->text) xpl_unload(_s);
+  if(_xpl_map_file(_p, _a, &view, &size) != XS_OK) return XS_ERR;
+  if(!view) return xpl_load_n(_s, "", 0);
+  xpl_load_n(_s, (const char*)view, size);
+  _s->mapping = view;
+  _s->mapping_size = size;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_load_stream(xpl_context_t* _s, xpl_reader_func _r, void* _u, char* _b, int _l) {
+  xpl_assert(_s && _r && _b && _l > 2);
+  if(_s->text) xpl_unload(_s);
+  _s->reader = _r;
+  _s->reader_userdata = _u;
+  _s->window = _b;
+  _s->window_size = _l;
+  _b[0] = '\0';
+  _s->cursor = _s->text = _s->text_end = _b;
+  _s->pc = 0;
+  _s->literal = 0;
+  _s->if_statement_depth = 0;
+  _s->active_lanes = _s->lanes;
+  _s->bool_value = 0;
+  _s->bool_composing = XBC_NIL;
+  _s->skip_kind = XSK_NONE;
+  _s->skip_body = 0;
+  _s->memo_epoch++;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_reload(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  if(_s->reader) return XS_ERR;
+  _s->cursor = _s->text;
+  _s->pc = 0;
+  _s->literal = 0;
+  _s->param_end = NULL;
+  _s->if_statement_depth = 0;
+  _s->active_lanes = _s->lanes;
+  _s->bool_value = 0;
+  _s->bool_composing = XBC_NIL;
+  _s->skip_kind = XSK_NONE;
+  _s->skip_body = 0;
+  _s->memo_epoch++;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_unload(xpl_context_t* _s) {
+  xpl_assert(_s);
+  _xpl_unmap_file(_s->mapping, _s->mapping_size);
+  _s->mapping = NULL;
+  _s->mapping_size = 0;
+  _xpl_unmap_file(_s->image_mapping, _s->image_mapping_size);
+  _s->image_mapping = NULL;
+  _s->image_mapping_size = 0;
+  _s->cursor = _s->text = _s->text_end = NULL;
+  _s->reader = NULL;
+  _s->reader_userdata = NULL;
+  _s->window = NULL;
+  _s->window_size = 0;
+  _s->stream_eof = 0;
+  _s->stream_in_comment = 0;
+  _s->program = NULL;
+  memset(_s->branch_from, 0, sizeof(_s->branch_from));
+  _s->pc = 0;
+  _s->param_end = NULL;
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+  if(_s->prepared) _xpl_prepared_release(_s->prepared);
+  _s->prepared = NULL;
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_run(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  xpl_assert(_s && _s->text && "Empty program");
+  while((_s->skip_kind || _xpl_has_more(_s)) && ret == XS_OK)
+    ret = xpl_step(_s);
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f) {
+  xpl_status_t ret = XS_OK;
+  const xpl_func_info_t* func = NULL;
+  ret = _xpl_peek_func(_s, &func);
+  if(_f) *_f = (xpl_func_info_t*)func;
+
+  return ret;
+}
+
+XPLINTERNAL xpl_status_t _xpl_peek_func(xpl_context_t* _s, const xpl_func_info_t** _f) {
+  xpl_status_t ret = XS_OK;
+  const xpl_func_info_t* func = NULL;
+  xpl_assert(_s && _s->text);
+  XPL_SKIP_MEANINGLESS(_s);
+  if(_f) *_f = NULL;
+  if(_s->cursor >= _s->text_end) return ret;
+  if(_xpl_is_comma(*(unsigned char*)_s->cursor)) {
+    _s->cursor++;
+  } else {
+    func = _xpl_find_func(_s, _s->cursor);
+    if(!func) return XS_ERR;
+    if(_f) *_f = func;
+  }
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_step(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  const xpl_func_info_t* func = NULL;
+  xpl_assert(_s && _s->text);
+  _s->scratch_used = 0;
+  if(_s->skip_kind) return _xpl_skip_resume(_s);
+  _xpl_stream_sync(_s);
+  if(_s->reader && (ret = _xpl_stream_statement(_s)) != XS_OK) return ret;
+  if((ret = _xpl_peek_func(_s, &func)) != XS_OK) return ret;
+  if(!func) return ret;
+  _XPL_TRACE(_s, XTK_CALL, func, (int)(_s->cursor - _s->text), XS_OK);
+  _s->cursor += func->length;
+  XPL_SKIP_MEANINGLESS(_s);
+#ifdef XPL_ENABLE_PROFILER
+  if(_s->profile) ret = _xpl_profile_call(_s, func, NULL);
+  else
+#endif /* XPL_ENABLE_PROFILER */
+  ret = _xpl_call(_s, func, NULL);
+  _XPL_TRACE(_s, XTK_RETURN, func, (int)(_s->cursor - _s->text), ret);
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_compile(xpl_context_t* _s, xpl_program_t* _p, xpl_instr_t* _c, int _l) {
+  return xpl_compile_literals(_s, _p, _c, _l, NULL, 0);
+}
+
+XPLAPI xpl_status_t xpl_compile_literals(xpl_context_t* _s, xpl_program_t* _p, xpl_instr_t* _c, int _l, xpl_literal_t* _v, int _m) {
+  xpl_status_t ret = XS_OK;
+  const xpl_func_info_t* func = NULL;
+  xpl_instr_t* instr = NULL;
+  const char* cursor = NULL;
+  int pending[XPL_IF_STACK_SIZE];
+  int chain[XPL_IF_STACK_SIZE];
+  int depth = 0;
+  int n = 0;
+  int k = 0;
+  int i = 0;
+  int j = 0;
+  xpl_assert(_s && _s->text && _p && _c);
+  if(_s->reader) return XS_ERR;
+  cursor = _s->cursor;
+  _s->cursor = _s->text;
+  _s->program = NULL;
+  _s->param_end = NULL;
+  do {
+    if((ret = _xpl_peek_func(_s, &func)) != XS_OK) break;
+    if(!func) continue;
+    if(n >= _l) { ret = XS_NO_ENOUGH_BUFFER_SIZE; break; }
+    instr = &_c[n];
+    instr->func = (int)(func - _s->registry->funcs);
+    instr->jump = -1;
+    _s->cursor += func->length;
+    XPL_SKIP_MEANINGLESS(_s);
+    instr->param_begin = instr->param_end = (int)(_s->cursor - _s->text);
+    while(xpl_has_param(_s) == XS_OK) {
+      if(!_v) {
+        xpl_skip_string(_s);
+      } else if(k < _m) {
+        _xpl_literal_parse(_s, &_v[k++]);
+      } else {
+        ret = XS_NO_ENOUGH_BUFFER_SIZE;
+        break;
+      }
+      instr->param_end = (int)(_s->cursor - _s->text);
+    }
+    if(ret != XS_OK) break;
+    if(func->func == _xpl_core_if) {
+      if(depth >= XPL_IF_STACK_SIZE) { ret = XS_ERR; break; }
+      pending[depth] = -1;
+      chain[depth] = -1;
+      depth++;
+    } else if(func->func == _xpl_core_then) {
+      if(!depth) { ret = XS_ERR; break; }
+      pending[depth - 1] = n;
+    } else if(func->func == _xpl_core_elseif || func->func == _xpl_core_else || func->func == _xpl_core_endif) {
+      if(!depth) { ret = XS_ERR; break; }
+      if(pending[depth - 1] >= 0) _c[pending[depth - 1]].jump = n;
+      pending[depth - 1] = -1;
+      if(func->func == _xpl_core_endif) {
+        for(i = chain[depth - 1]; i >= 0; i = j) {
+          j = _c[i].jump;
+          _c[i].jump = n;
+        }
+        depth--;
+      } else {
+        instr->jump = chain[depth - 1];
+        chain[depth - 1] = n;
+      }
+    }
+    n++;
+  } while(_s->cursor < _s->text_end);
+  if(ret == XS_OK && depth) ret = XS_ERR;
+  _s->cursor = cursor;
+  if(ret != XS_OK) return ret;
+  _p->instrs = _c;
+  _p->instrs_count = n;
+  _p->literals = _v;
+  _p->literals_count = k;
+  _s->program = _p;
+  _s->pc = 0;
+  _s->literal = 0;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_run_compiled(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  xpl_assert(_s && _s->text && _s->program && "Empty program");
+  while(_s->pc < _s->program->instrs_count && ret == XS_OK)
+    ret = xpl_step_compiled(_s);
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_step_compiled(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  const xpl_func_info_t* funcs = NULL;
+  const xpl_func_info_t* info = NULL;
+  const xpl_instr_t* instr = NULL;
+  xpl_if_frame_t* frame = NULL;
+  xpl_func_t func = NULL;
+  xpl_lanes_t lanes = 0;
+  xpl_assert(_s && _s->text && _s->program);
+  _s->scratch_used = 0;
+  funcs = _s->registry->funcs;
+  instr = &_s->program->instrs[_s->pc++];
+  info = &funcs[instr->func];
+  func = info->func;
+  if(func == _xpl_core_then || func == _xpl_core_elseif || func == _xpl_core_else || func == _xpl_core_endif) {
+    if(!_s->if_statement_depth) return XS_ERR;
+    frame = &_s->if_frames[_s->if_statement_depth - 1];
+  }
+  /* Keywords run inline, but are traced as calls like in interpreted runs. */
+  _XPL_TRACE(_s, XTK_CALL, info, instr->param_begin, XS_OK);
+  if(func == _xpl_core_then) {
+    lanes = _s->bool_value & frame->remaining_lanes;
+#ifdef XPL_ENABLE_PROFILER
+    if(_s->profile) _xpl_profile_branch(_s, instr->param_begin, lanes != 0);
+#endif /* XPL_ENABLE_PROFILER */
+    _XPL_TRACE(_s, lanes ? XTK_TAKEN : XTK_SKIPPED, NULL, instr->param_begin, XS_OK);
+    if(lanes) {
+      _s->active_lanes = lanes;
+      frame->remaining_lanes &= ~lanes;
+      frame->taken = 1;
+    } else {
+      _XPL_TRACE(_s, XTK_SKIP_BEGIN, NULL, instr->param_end, XS_OK);
+      _XPL_TRACE(_s, XTK_SKIP_END, NULL, _s->program->instrs[instr->jump].param_begin, XS_OK);
+      _s->pc = instr->jump + 1;
+      func = funcs[_s->program->instrs[instr->jump].func].func;
+      if(func == _xpl_core_endif) {
+        _s->active_lanes = frame->outer_lanes;
+        _s->if_statement_depth--;
+      } else if(func == _xpl_core_else) {
+        frame->remaining_lanes = 0;
+        frame->taken = 1;
+      }
+    }
+    _s->bool_value = 0;
+    _s->bool_composing = XBC_NIL;
+  } else if(func == _xpl_core_elseif || func == _xpl_core_else) {
+    if(!frame->remaining_lanes) {
+      _XPL_TRACE(_s, XTK_SKIP_BEGIN, NULL, instr->param_end, XS_OK);
+      _XPL_TRACE(_s, XTK_SKIP_END, NULL, _s->program->instrs[instr->jump].param_begin, XS_OK);
+      _s->pc = instr->jump + 1;
+      _s->active_lanes = frame->outer_lanes;
+      _s->if_statement_depth--;
+    } else {
+      _s->active_lanes = frame->remaining_lanes;
+      if(func == _xpl_core_else) frame->remaining_lanes = 0;
+      else frame->taken = 0;
+    }
+  } else if(func == _xpl_core_endif) {
+    _s->active_lanes = frame->outer_lanes;
+    _s->if_statement_depth--;
+  } else if(func == _xpl_core_or || func == _xpl_core_and) {
+    _s->bool_composing = func == _xpl_core_or ? XBC_OR : XBC_AND;
+    if(_s->pc < _s->program->instrs_count && _xpl_bool_known(_s) && _xpl_func_skippable(&funcs[_s->program->instrs[_s->pc].func]))
+      _s->pc++;
+  } else {
+    _s->cursor = _s->text + instr->param_begin;
+    _s->param_end = _s->text + instr->param_end;
+#ifdef XPL_ENABLE_PROFILER
+    if(_s->profile) ret = _xpl_profile_call(_s, info, _s->param_end);
+    else
+#endif /* XPL_ENABLE_PROFILER */
+    ret = _xpl_call(_s, info, _s->param_end);
+    _s->cursor = _s->param_end;
+    _s->param_end = NULL;
+  }
+  _XPL_TRACE(_s, XTK_RETURN, info, instr->param_end, ret);
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_image_save(xpl_context_t* _s, FILE* _fp) {
+  static const char pad[sizeof(double)] = { '\0' };
+  xpl_image_header_t h;
+  size_t n = 0;
+  size_t m = 0;
+  xpl_assert(_s && _s->text && _fp);
+  if(!_s->program) return XS_ERR;
+  _xpl_image_header(_s, &h);
+  h.instrs_count = _s->program->instrs_count;
+  h.literals_count = _s->program->literals ? _s->program->literals_count : 0;
+  n = (size_t)h.instrs_count;
+  m = (size_t)h.literals_count;
+  if(fwrite(&h, sizeof(h), 1, _fp) != 1) return XS_ERR;
+  if(n && fwrite(_s->program->instrs, sizeof(xpl_instr_t), n, _fp) != n) return XS_ERR;
+  if(!m) return XS_OK;
+  n = _xpl_image_literals_at(h.instrs_count) - sizeof(h) - n * sizeof(xpl_instr_t);
+  if(n && fwrite(pad, 1, n, _fp) != n) return XS_ERR;
+  if(fwrite(_s->program->literals, sizeof(xpl_literal_t), m, _fp) != m) return XS_ERR;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_image_load(xpl_context_t* _s, xpl_program_t* _p, const void* _b, size_t _l) {
+  const xpl_image_header_t* h = (const xpl_image_header_t*)_b;
+  const xpl_instr_t* c = NULL;
+  const xpl_literal_t* v = NULL;
+  xpl_image_header_t e;
+  xpl_func_t f = NULL;
+  xpl_func_t t = NULL;
+  size_t at = 0;
+  int i = 0;
+  xpl_assert(_s && _s->text && _p);
+  if(_s->reader) return XS_ERR;
+  _s->program = NULL;
+  _s->pc = 0;
+  if(!_b || ((size_t)_b & (sizeof(int) - 1)) || _l < sizeof(xpl_image_header_t)) return XS_IMAGE_MISMATCH;
+  _xpl_image_header(_s, &e);
+  if(h->magic != e.magic || h->version != e.version || h->instr_size != e.instr_size || h->literal_size != e.literal_size ||
+    h->escape_mode != e.escape_mode || h->registry_hash != e.registry_hash || h->text_length != e.text_length || h->text_hash != e.text_hash ||
+    h->instrs_count < 0 || (size_t)h->instrs_count > (_l - sizeof(xpl_image_header_t)) / sizeof(xpl_instr_t) || h->literals_count < 0)
+    return XS_IMAGE_MISMATCH;
+  if(!h->literals_count) {
+    if(_l != sizeof(xpl_image_header_t) + (size_t)h->instrs_count * sizeof(xpl_instr_t)) return XS_IMAGE_MISMATCH;
+  } else {
+    at = _xpl_image_literals_at(h->instrs_count);
+    if(((size_t)_b & (sizeof(double) - 1)) || _l < at || (_l - at) % sizeof(xpl_literal_t) ||
+      (_l - at) / sizeof(xpl_literal_t) != (size_t)h->literals_count)
+      return XS_IMAGE_MISMATCH;
+    v = (const xpl_literal_t*)((const char*)_b + at);
+  }
+  for(i = 0; i < h->literals_count; i++) {
+    if(v[i].begin < (i ? v[i - 1].end : 0) || v[i].begin >= v[i].end || v[i].end > h->text_length ||
+      v[i].value_begin < v[i].begin || v[i].value_begin > v[i].value_end || v[i].value_end > v[i].end ||
+      (v[i].flags & ~(XLF_INT | XLF_DOUBLE | XLF_QUOTED | XLF_ESCAPED)) ||
+      ((v[i].flags & XLF_ESCAPED) && !(v[i].flags & XLF_QUOTED)))
+      return XS_IMAGE_MISMATCH;
+  }
+  c = (const xpl_instr_t*)(h + 1);
+  for(i = 0; i < h->instrs_count; i++) {
+    if(c[i].func < 0 || c[i].func >= _s->registry->funcs_count ||
+      c[i].param_begin < 0 || c[i].param_begin > c[i].param_end || c[i].param_end > h->text_length ||
+      c[i].jump < -1 || c[i].jump >= h->instrs_count)
+      return XS_IMAGE_MISMATCH;
+    f = _s->registry->funcs[c[i].func].func;
+    if(f != _xpl_core_then && f != _xpl_core_elseif && f != _xpl_core_else) continue;
+    if(c[i].jump <= i || c[c[i].jump].func < 0 || c[c[i].jump].func >= _s->registry->funcs_count)
+      return XS_IMAGE_MISMATCH;
+    t = _s->registry->funcs[c[c[i].jump].func].func;
+    if(t != _xpl_core_endif && (f != _xpl_core_then || (t != _xpl_core_elseif && t != _xpl_core_else)))
+      return XS_IMAGE_MISMATCH;
+  }
+  _p->instrs = c;
+  _p->instrs_count = h->instrs_count;
+  _p->literals = v;
+  _p->literals_count = h->literals_count;
+  _s->program = _p;
+  _s->literal = 0;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_image_load_file(xpl_context_t* _s, xpl_program_t* _p, const char* _f) {
+  xpl_status_t ret = XS_OK;
+  void* view = NULL;
+  size_t size = 0;
+  xpl_assert(_s && _s->text && _p && _f);
+  _s->program = NULL;
+  _xpl_unmap_file(_s->image_mapping, _s->image_mapping_size);
+  _s->image_mapping = NULL;
+  _s->image_mapping_size = 0;
+  if(_xpl_map_file(_f, XAH_WILLNEED, &view, &size) != XS_OK) view = NULL;
+  ret = xpl_image_load(_s, _p, view, size);
+  if(ret != XS_OK) {
+    _xpl_unmap_file(view, size);
+
+    return ret;
+  }
+  _s->image_mapping = view;
+  _s->image_mapping_size = size;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_run_budget(xpl_context_t* _s, int _n) {
+  xpl_assert(_s && _s->text && _n >= 0);
+  _s->budget = _n;
+
+  return _xpl_run_budgeted(_s);
+}
+
+XPLAPI xpl_status_t xpl_run_deadline(xpl_context_t* _s, xpl_clock_func _c, void* _u, xpl_uint64_t _d) {
+  xpl_assert(_s && _s->text && _c);
+  _s->budget = INT_MAX;
+  _s->clock = _c;
+  _s->clock_userdata = _u;
+  _s->deadline = _d;
+
+  return _xpl_run_budgeted(_s);
+}
+
+XPLAPI xpl_status_t xpl_translate(xpl_context_t* _s, xpl_instr_t* _c, int _l, const char* _n, FILE* _fp) {
+  xpl_status_t ret = XS_OK;
+  xpl_program_t prog;
+  const xpl_program_t* program = NULL;
+  const xpl_func_info_t* funcs = NULL;
+  const xpl_func_info_t* info = NULL;
+  const xpl_instr_t* instr = NULL;
+  xpl_func_t func = NULL;
+  int pc = 0;
+  int n = 0;
+  int i = 0;
+  int j = 0;
+  xpl_assert(_s && _s->text && _c && _n && _fp);
+  program = _s->program;
+  pc = _s->pc;
+  ret = xpl_compile(_s, &prog, _c, _l);
+  _s->program = program;
+  _s->pc = pc;
+  if(ret != XS_OK) return ret;
+  n = prog.instrs_count;
+  funcs = _s->registry->funcs;
+  for(i = 0; i < n; i++) {
+    if(!funcs[_c[i].func].symbol) return XS_ERR;
+  }
+  fprintf(_fp, "static const char %s_text[] =\n", _n);
+  _xpl_translate_text(_fp, _s->text, _s->text_end);
+  fprintf(_fp, ";\n\nstatic xpl_status_t %s(xpl_context_t* _s) {\n", _n);
+  fprintf(_fp, "  xpl_status_t ret = XS_OK;\n");
+  fprintf(_fp, "  switch(_s->pc) {\n");
+  fprintf(_fp, "    case 0:\n");
+  for(i = 0; i < n; i++) {
+    if(!(funcs[_c[i].func].flags & XFF_PURE)) continue;
+    for(j = 0; j < i && _c[j].func != _c[i].func; j++) { }
+    if(j < i) continue;
+    fprintf(_fp, "      if(_s->registry->funcs_count <= %d || _s->registry->funcs[%d].func != %s) return XS_ERR;\n",
+      _c[i].func, _c[i].func, funcs[_c[i].func].symbol);
+  }
+  fprintf(_fp, "      xpl_load_n(_s, %s_text, sizeof(%s_text) - 1);\n      break;\n", _n, _n);
+  for(i = 1; i <= n; i++) {
+    func = funcs[_c[i - 1].func].func;
+    if(i == n || (func != _xpl_core_then && func != _xpl_core_elseif && func != _xpl_core_else &&
+      func != _xpl_core_endif && func != _xpl_core_or && func != _xpl_core_and))
+      fprintf(_fp, "    case %d: goto L%d;\n", i, i);
+  }
+  fprintf(_fp, "    default: return XS_ERR;\n  }\n");
+  for(i = 0; i < n; i++) {
+    instr = &_c[i];
+    info = &funcs[instr->func];
+    func = info->func;
+    if(i && _xpl_translate_label(funcs, _c, n, i)) fprintf(_fp, "L%d:\n", i);
+    if(func == _xpl_core_then) {
+      fprintf(_fp, "  if(!xpl_aot_then(_s, %s)) goto L%d;\n", funcs[_c[instr->jump].func].symbol, instr->jump + 1);
+    } else if(func == _xpl_core_elseif || func == _xpl_core_else) {
+      fprintf(_fp, "  if(!xpl_aot_branch(_s, %s)) goto L%d;\n", info->symbol, instr->jump + 1);
+    } else if(func == _xpl_core_endif) {
+      fprintf(_fp, "  _xpl_core_endif(_s);\n");
+    } else if(func == _xpl_core_or || func == _xpl_core_and) {
+      fprintf(_fp, "  _s->bool_composing = %s;\n", func == _xpl_core_or ? "XBC_OR" : "XBC_AND");
+      if(i + 1 < n && _xpl_func_skippable(&funcs[_c[i + 1].func]))
+        fprintf(_fp, "  if(_xpl_bool_known(_s)) goto L%d;\n", i + 2);
+    } else {
+      fprintf(_fp, "  _s->scratch_used = 0;\n");
+      fprintf(_fp, "  _s->cursor = _s->text + %d;\n", instr->param_begin);
+      fprintf(_fp, "  _s->param_end = _s->text + %d;\n", instr->param_end);
+      if(info->flags & XFF_PURE)
+        fprintf(_fp, "  ret = _xpl_call(_s, &_s->registry->funcs[%d], _s->param_end); /* %s */\n", instr->func, info->symbol);
+      else
+        fprintf(_fp, "  ret = (%s)(_s);\n", info->symbol);
+      fprintf(_fp, "  _s->cursor = _s->param_end;\n");
+      fprintf(_fp, "  _s->param_end = NULL;\n");
+      fprintf(_fp, "  if(ret != XS_OK) { _s->pc = %d; return ret; }\n", i + 1);
+    }
+  }
+  if(n) fprintf(_fp, "L%d:\n", n);
+  fprintf(_fp, "  _s->pc = %d;\n\n  return ret;\n}\n", n);
+
+  return ferror(_fp) ? XS_ERR : XS_OK;
+}
+
+XPLAPI int xpl_aot_then(xpl_context_t* _s, xpl_func_t _t) {
+  xpl_if_frame_t* frame = NULL;
+  xpl_lanes_t lanes = 0;
+  xpl_assert(_s && _s->if_statement_depth);
+  frame = &_s->if_frames[_s->if_statement_depth - 1];
+  lanes = _s->bool_value & frame->remaining_lanes;
+  _s->bool_value = 0;
+  _s->bool_composing = XBC_NIL;
+  if(lanes) {
+    _s->active_lanes = lanes;
+    frame->remaining_lanes &= ~lanes;
+    frame->taken = 1;
+
+    return 1;
+  }
+  if(_t == _xpl_core_endif) {
+    _s->active_lanes = frame->outer_lanes;
+    _s->if_statement_depth--;
+  } else if(_t == _xpl_core_else) {
+    frame->remaining_lanes = 0;
+    frame->taken = 1;
+  }
+
+  return 0;
+}
+
+XPLAPI int xpl_aot_branch(xpl_context_t* _s, xpl_func_t _f) {
+  xpl_if_frame_t* frame = NULL;
+  xpl_assert(_s && _s->if_statement_depth);
+  frame = &_s->if_frames[_s->if_statement_depth - 1];
+  if(!frame->remaining_lanes) {
+    _s->active_lanes = frame->outer_lanes;
+    _s->if_statement_depth--;
+
+    return 0;
+  }
+  _s->active_lanes = frame->remaining_lanes;
+  if(_f == _xpl_core_else) frame->remaining_lanes = 0;
+  else frame->taken = 0;
+
+  return 1;
+}
+
+XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  if(_s->cursor < _s->text_end && _xpl_is_squote(*(unsigned char*)_s->cursor)) {
+    _s->cursor = _xpl_scan_char(_s->cursor + 1, _s->text_end, '\'');
+    if(_s->cursor < _s->text_end && _xpl_is_squote(*(unsigned char*)_s->cursor)) _s->cursor++;
+    else if(_s->reader && !_s->stream_eof) _s->stream_in_comment = 1;
+
+    return XS_OK;
+  }
+
+  return XS_NO_COMMENT;
+}
+
+XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s) {
+  const xpl_func_info_t* func = NULL;
+  xpl_assert(_s && _s->text);
+  XPL_SKIP_MEANINGLESS(_s);
+  if(_s->param_end) return _s->cursor < _s->param_end ? XS_OK : XS_NO_PARAM;
+  if(_s->cursor >= _s->text_end || _s->cursor[0] == '\0') return XS_NO_PARAM;
+  if(_xpl_is_comma(*(unsigned char*)_s->cursor)) return XS_NO_PARAM;
+  _xpl_peek_func(_s, &func);
+
+  return (func ? XS_NO_PARAM : XS_OK);
+}
+
+XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s) {
+  const xpl_literal_t* lit = NULL;
+  const char* src = NULL;
+  const char* end = NULL;
+  xpl_assert(_s && _s->text);
+  if((lit = _xpl_literal_at(_s)) != NULL) {
+    _s->cursor = _s->text + lit->end;
+
+    return XS_OK;
+  }
+  src = _s->cursor;
+  end = _s->text_end;
+  if(src >= end) return XS_OK;
+  if(_xpl_is_dquote(*(unsigned char*)src) && _xpl_is_builtin_escape(_s)) {
+    src = _xpl_scan_chars(src + 1, end, '"', '\\');
+    while(src < end && *src == '\\') {
+      src += src + 1 < end && src[1] != '\0' ? 2 : 1;
+      src = _xpl_scan_chars(src, end, '"', '\\');
+    }
+    if(src < end && _xpl_is_dquote(*(unsigned char*)src)) src++;
+  } else if(_xpl_is_dquote(*(unsigned char*)src) && _s->escape_detect) {
+    src++;
+    while(src < end && *src != '\0' && !_xpl_is_dquote(*(unsigned char*)src)) {
+      if((*_s->escape_detect)(*(unsigned char*)src) && src + 1 < end && src[1] != '\0') src++;
+      src++;
+    }
+    if(src < end && _xpl_is_dquote(*(unsigned char*)src)) src++;
+  } else if(_xpl_is_dquote(*(unsigned char*)src)) {
+    src = _xpl_scan_char(src + 1, end, '"');
+    if(src < end && _xpl_is_dquote(*(unsigned char*)src)) src++;
+  } else {
+    src = _xpl_scan_token_end(_s, src);
+  }
+  _s->cursor = src;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pop_long(xpl_context_t* _s, long* _o) {
+  xpl_status_t ret = XS_OK;
+  xpl_int64_t v = 0;
+  xpl_assert(_s && _s->text && _o);
+  if((ret = xpl_pop_int64(_s, &v)) != XS_OK) return ret;
+  if(v < LONG_MIN || v > LONG_MAX) return XS_PARAM_TYPE_ERROR;
+  *_o = (long)v;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_pop_int64(xpl_context_t* _s, xpl_int64_t* _o) {
+  xpl_status_t ret = XS_OK;
+  const xpl_literal_t* lit = NULL;
+  const char* b = NULL;
+  const char* e = NULL;
+  xpl_uint64_t v = 0;
+  int neg = 0;
+  xpl_assert(_s && _s->text && _o);
+  if((lit = _xpl_literal_at(_s)) != NULL && !(lit->flags & XLF_ESCAPED)) {
+    _s->cursor = _s->text + lit->end;
+    if(!(lit->flags & XLF_INT)) return XS_PARAM_TYPE_ERROR;
+    *_o = lit->integer;
+
+    return ret;
+  }
+  _s->cursor = _xpl_number_token(_s, &b, &e);
+  if((ret = _xpl_parse_integer(b, e, &v, &neg)) != XS_OK) return ret;
+  if(neg) {
+    if(v > (xpl_uint64_t)1 << 63) return XS_PARAM_TYPE_ERROR;
+    *_o = (xpl_int64_t)(0 - v);
+  } else {
+    if(v > (((xpl_uint64_t)1 << 63) - 1)) return XS_PARAM_TYPE_ERROR;
+    *_o = (xpl_int64_t)v;
+  }
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_pop_uint64(xpl_context_t* _s, xpl_uint64_t* _o) {
+  xpl_status_t ret = XS_OK;
+  const xpl_literal_t* lit = NULL;
+  const char* b = NULL;
+  const char* e = NULL;
+  xpl_uint64_t v = 0;
+  int neg = 0;
+  xpl_assert(_s && _s->text && _o);
+  if((lit = _xpl_literal_at(_s)) != NULL && (lit->flags & (XLF_INT | XLF_ESCAPED)) == XLF_INT) {
+    _s->cursor = _s->text + lit->end;
+    if(lit->integer < 0) return XS_PARAM_TYPE_ERROR;
+    *_o = (xpl_uint64_t)lit->integer;
+
+    return ret;
+  }
+  _s->cursor = _xpl_number_token(_s, &b, &e);
+  if((ret = _xpl_parse_integer(b, e, &v, &neg)) != XS_OK) return ret;
+  if(neg && v) return XS_PARAM_TYPE_ERROR;
+  *_o = v;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o) {
+  const xpl_literal_t* lit = NULL;
+  const char* b = NULL;
+  const char* e = NULL;
+  xpl_assert(_s && _s->text && _o);
+  if((lit = _xpl_literal_at(_s)) != NULL && !(lit->flags & XLF_ESCAPED)) {
+    _s->cursor = _s->text + lit->end;
+    if(!(lit->flags & XLF_DOUBLE)) return XS_PARAM_TYPE_ERROR;
+    *_o = lit->real;
+
+    return XS_OK;
+  }
+  _s->cursor = _xpl_number_token(_s, &b, &e);
+
+  return _xpl_parse_double(b, e, _o);
+}
+
+XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l) {
+  return _xpl_pop_string(_s, _o, _l, NULL);
+}
+
+XPLAPI xpl_status_t xpl_pop_string_view(xpl_context_t* _s, xpl_string_view_t* _o, char* _b, int _l) {
+  xpl_status_t ret = XS_OK;
+  const xpl_literal_t* lit = NULL;
+  const char* src = NULL;
+  const char* end = NULL;
+  int escaped = 0;
+  int n = 0;
+  xpl_assert(_s && _s->text && _o);
+  if((lit = _xpl_literal_at(_s)) != NULL && !(lit->flags & XLF_ESCAPED)) {
+    _o->ptr = _s->text + lit->value_begin;
+    _o->len = (size_t)(lit->value_end - lit->value_begin);
+    _s->cursor = _s->text + lit->end;
+
+    return ret;
+  }
+  src = _s->cursor;
+  if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) {
+    src++;
+    if(_xpl_is_builtin_escape(_s)) {
+      end = _xpl_scan_chars(src, _s->text_end, '"', '\\');
+      escaped = end < _s->text_end && *end == '\\';
+    } else if(_s->escape_detect) {
+      for(end = src; end < _s->text_end && *end != '\0' && !_xpl_is_dquote(*(unsigned char*)end); end++) {
+        if((*_s->escape_detect)(*(unsigned char*)end)) { escaped = 1; break; }
+      }
+    } else {
+      end = _xpl_scan_char(src, _s->text_end, '"');
+    }
+    if(escaped) {
+      if(!_b) return XS_NO_ENOUGH_BUFFER_SIZE;
+      if((ret = _xpl_pop_string(_s, _b, _l, &n)) != XS_OK) return ret;
+      _o->ptr = _b;
+      _o->len = (size_t)n;
+
+      return ret;
+    }
+    _s->cursor = end < _s->text_end && _xpl_is_dquote(*(unsigned char*)end) ? end + 1 : end;
+  } else {
+    end = _xpl_scan_token_end(_s, src);
+    _s->cursor = end;
+  }
+  _o->ptr = src;
+  _o->len = (size_t)(end - src);
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_set_scratch(xpl_context_t* _s, char* _b, int _l) {
+  xpl_assert(_s && (_b || !_l) && _l >= 0);
+  _s->scratch = _b;
+  _s->scratch_size = _l;
+  _s->scratch_used = 0;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_scratch_alloc(xpl_context_t* _s, int _n, void** _o) {
+  int used = 0;
+  xpl_assert(_s && _n >= 0 && _o);
+  used = (_s->scratch_used + (int)sizeof(double) - 1) & ~((int)sizeof(double) - 1);
+  if(used > _s->scratch_size || _n > _s->scratch_size - used) return XS_NO_ENOUGH_BUFFER_SIZE;
+  *_o = _s->scratch + used;
+  _s->scratch_used = used + _n;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pop_string_scratch(xpl_context_t* _s, xpl_string_view_t* _o) {
+  xpl_status_t ret = XS_OK;
+  char* buf = NULL;
+  xpl_assert(_s && _o);
+  buf = _s->scratch ? _s->scratch + _s->scratch_used : NULL;
+  ret = xpl_pop_string_view(_s, _o, buf, _s->scratch_size - _s->scratch_used);
+  if(ret == XS_OK && buf && _o->ptr == buf) _s->scratch_used += (int)_o->len + 1;
+
+  return ret;
+}
+
+XPLAPI int xpl_is_backslash(unsigned char _c) {
+  return _c == '\\';
+}
+
+XPLAPI int xpl_parse_escape(char** _d, const char** _s) {
+  xpl_assert(_d && *_d && _s && *_s);
+
+  return _xpl_decode_escape(_d, _s, NULL);
+}
+
+XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b) {
+  xpl_assert(_s && _s->text);
+
+  return xpl_push_lanes(_s, _b ? _s->active_lanes : 0);
+}
+
+XPLAPI xpl_status_t xpl_push_lanes(xpl_context_t* _s, xpl_lanes_t _m) {
+  xpl_assert(_s && _s->text);
+  _m &= _s->active_lanes;
+  switch(_s->bool_composing) {
+    case XBC_NIL: _s->bool_value = _m; break;
+    case XBC_OR: _s->bool_value |= _m; break;
+    case XBC_AND: _s->bool_value &= _m; break;
+    default: xpl_assert(!"Unknow boolean composing type"); break;
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_set_lanes(xpl_context_t* _s, int _n) {
+  xpl_assert(_s);
+  if(_n < 1 || _n > XPL_MAX_LANES || _s->if_statement_depth) return XS_ERR;
+  _s->lanes = _n == XPL_MAX_LANES ? ~(xpl_lanes_t)0 : ((xpl_lanes_t)1 << _n) - 1;
+  _s->active_lanes = _s->lanes;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_active_lanes(xpl_context_t* _s, xpl_lanes_t* _m) {
+  xpl_assert(_s && _m);
+  *_m = _s->active_lanes;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_memo_bump(xpl_context_t* _s) {
+  xpl_assert(_s);
+  _s->memo_epoch++;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_scheduler_open(xpl_scheduler_t* _c, xpl_context_t** _a, int _l, xpl_scheduler_done_func _d) {
+  xpl_assert(_c && _a && _l > 0);
+  _c->contexts = _a;
+  _c->contexts_count = 0;
+  _c->contexts_size = _l;
+  _c->done = _d;
+  _c->budget = 0;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_scheduler_add(xpl_scheduler_t* _c, xpl_context_t* _s) {
+  xpl_assert(_c && _s && _s->text);
+  if(_c->contexts_count >= _c->contexts_size) return XS_NO_ENOUGH_BUFFER_SIZE;
+  _c->contexts[_c->contexts_count++] = _s;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_scheduler_tick(xpl_scheduler_t* _c) {
+  xpl_status_t ret = XS_OK;
+  xpl_context_t* s = NULL;
+  int i = 0;
+  xpl_assert(_c);
+  while(i < _c->contexts_count) {
+    s = _c->contexts[i];
+    if(_c->budget > 0) ret = xpl_run_budget(s, _c->budget);
+    else ret = s->program ? xpl_run_compiled(s) : xpl_run(s);
+    if(ret == XS_SUSPENT || ret == XS_PREEMPTED) { i++; continue; }
+    _c->contexts[i] = _c->contexts[--_c->contexts_count];
+    if(_c->done) _c->done(s, ret);
+  }
+
+  return _c->contexts_count ? XS_SUSPENT : XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_scheduler_run(xpl_scheduler_t* _c) {
+  xpl_assert(_c);
+  while(xpl_scheduler_tick(_c) == XS_SUSPENT) { }
+
+  return XS_OK;
+}
+
+#ifdef XPL_ENABLE_PROFILER
+XPLAPI xpl_status_t xpl_profile_open(xpl_profile_t* _p, const xpl_registry_t* _r, xpl_prof_func_t* _f, xpl_prof_branch_t* _b, int _l) {
+  xpl_assert(_p && _r && _f && (_b || !_l));
+  _p->registry = _r;
+  _p->funcs = _f;
+  _p->branches = _b;
+  _p->branches_size = _l;
+
+  return xpl_profile_reset(_p);
+}
+
+XPLAPI xpl_status_t xpl_profile_attach(xpl_context_t* _s, xpl_profile_t* _p) {
+  xpl_assert(_s);
+  if(_p && _p->registry != _s->registry) return XS_ERR;
+  _s->profile = _p;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_profile_reset(xpl_profile_t* _p) {
+  int i = 0;
+  xpl_assert(_p);
+  memset(_p->funcs, 0, _p->registry->funcs_count * sizeof(xpl_prof_func_t));
+  for(i = 0; i < _p->branches_size; i++) {
+    _p->branches[i].offset = -1;
+    _p->branches[i].taken = _p->branches[i].skipped = 0;
+  }
+  _p->branches_count = 0;
+  _p->nested = 0;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_profile_get(xpl_profile_t* _p, const char* _n, xpl_prof_func_t* _o) {
+  int i = 0;
+  xpl_assert(_p && _n && _o);
+  for(i = 0; i < _p->registry->funcs_count; i++) {
+    if(!strcmp(_p->registry->funcs[i].name, _n)) {
+      *_o = _p->funcs[i];
+
+      return XS_OK;
+    }
+  }
+
+  return XS_ERR;
+}
+
+XPLAPI xpl_status_t xpl_profile_dump(xpl_profile_t* _p, FILE* _fp, xpl_prof_format_t _f) {
+  const xpl_prof_func_t* f = NULL;
+  const xpl_prof_branch_t* b = NULL;
+  int i = 0;
+  int n = 0;
+  xpl_assert(_p && _fp);
+  if(_f == XPF_CSV) fprintf(_fp, "kind,name,offset,calls,inclusive,exclusive,taken,skipped\n");
+  else fprintf(_fp, "{\"funcs\":[");
+  for(i = 0; i < _p->registry->funcs_count; i++) {
+    f = &_p->funcs[i];
+    if(_f == XPF_CSV) {
+      fprintf(_fp, "func,%s,,%llu,%llu,%llu,,\n", _p->registry->funcs[i].name,
+        (unsigned long long)f->calls, (unsigned long long)f->inclusive, (unsigned long long)f->exclusive);
+    } else {
+      fprintf(_fp, "%s{\"name\":", i ? "," : "");
+      _xpl_write_json_string(_fp, _p->registry->funcs[i].name);
+      fprintf(_fp, ",\"calls\":%llu,\"inclusive\":%llu,\"exclusive\":%llu}",
+        (unsigned long long)f->calls, (unsigned long long)f->inclusive, (unsigned long long)f->exclusive);
+    }
+  }
+  if(_f == XPF_JSON) fprintf(_fp, "],\"branches\":[");
+  for(i = 0; i < _p->branches_size; i++) {
+    b = &_p->branches[i];
+    if(b->offset < 0) continue;
+    if(_f == XPF_CSV) {
+      fprintf(_fp, "branch,,%d,,,,%llu,%llu\n", b->offset,
+        (unsigned long long)b->taken, (unsigned long long)b->skipped);
+    } else {
+      fprintf(_fp, "%s{\"offset\":%d,\"taken\":%llu,\"skipped\":%llu}", n++ ? "," : "", b->offset,
+        (unsigned long long)b->taken, (unsigned long long)b->skipped);
+    }
+  }
+  if(_f == XPF_JSON) fprintf(_fp, "]}\n");
+
+  return XS_OK;
+}
+#endif /* XPL_ENABLE_PROFILER */
+
+#ifdef XPL_ENABLE_TRACE
+XPLAPI xpl_status_t xpl_trace_open(xpl_trace_ring_t* _r, xpl_trace_event_t* _e, int _l) {
+  xpl_assert(_r && _e && _l > 0 && !(_l & (_l - 1)));
+  memset(_r, 0, sizeof(xpl_trace_ring_t));
+  _r->events = _e;
+  _r->size = (unsigned)_l;
+  _r->ticks_per_us = _xpl_ticks_per_us();
+  _r->base_us = _xpl_ref_us();
+  _r->base = _xpl_ticks();
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_trace_attach(xpl_context_t* _s, xpl_trace_ring_t* _r) {
+  xpl_assert(_s);
+  _s->trace = _r;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_trace_pop(xpl_trace_ring_t* _r, xpl_trace_event_t* _e) {
+  unsigned tail = 0;
+  xpl_assert(_r && _e);
+  tail = _r->tail;
+  if(tail == _XPL_LOAD_ACQUIRE(&_r->head)) return XS_ERR;
+  *_e = _r->events[tail & (_r->size - 1)];
+  _XPL_STORE_RELEASE(&_r->tail, tail + 1);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_trace_export(xpl_trace_ring_t* _r, const xpl_registry_t* _g, FILE* _fp, int _tid, double _t) {
+  static const char* const names[] = { "call", "return", "taken", "skipped", "skip", "skip" };
+  xpl_trace_event_t e;
+  const char* name = NULL;
+  double us = 0.0;
+  int n = 0;
+  xpl_assert(_r && _g && _fp);
+  if(_t <= 0.0) _t = _r->ticks_per_us;
+  if(_t <= 0.0) {
+    us = _xpl_ref_us() - _r->base_us;
+    _t = us > 0.0 ? (double)(_xpl_ticks() - _r->base) / us : 1.0;
+  }
+  fprintf(_fp, "{\"traceEvents\":[");
+  while(xpl_trace_pop(_r, &e) == XS_OK) {
+    name = e.func >= 0 && e.func < _g->funcs_count ? _g->funcs[e.func].name : names[e.kind];
+    fprintf(_fp, "%s{\"name\":", n++ ? ",\n" : "");
+    _xpl_write_json_string(_fp, name);
+    fprintf(_fp, ",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"offset\":%d",
+      names[e.kind],
+      e.kind == XTK_CALL || e.kind == XTK_SKIP_BEGIN ? "B" : e.kind == XTK_RETURN || e.kind == XTK_SKIP_END ? "E" : "i",
+      (double)(e.ticks - _r->base) / _t, _tid, e.offset);
+    if(e.kind == XTK_RETURN) fprintf(_fp, ",\"status\":%d", e.status);
+    fprintf(_fp, "}%s}", e.kind == XTK_TAKEN || e.kind == XTK_SKIPPED ? ",\"s\":\"t\"" : "");
+  }
+  fprintf(_fp, "]}\n");
+
+  return XS_OK;
+}
+#endif /* XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_POOL
+XPLAPI xpl_status_t xpl_pool_open(xpl_pool_t* _p, const xpl_context_t* _s, xpl_worker_t* _w, int _n, int _a, xpl_job_done_func _d) {
+  xpl_worker_t* w = NULL;
+  int i = 0;
+  xpl_assert(_p && _s && _w && _n > 0);
+  xpl_assert(_s->registry && !_s->text && "Prototype must be opened without script loaded");
+  memset(_p, 0, sizeof(xpl_pool_t));
+  _p->workers = _w;
+  _p->workers_count = _n;
+  _p->done = _d;
+  _XPL_MUTEX_INIT(&_p->lock);
+  _XPL_COND_INIT(&_p->wake);
+  _XPL_COND_INIT(&_p->idle);
+  for(i = 0; i < _n; i++) {
+    w = &_w[i];
+    memset(w, 0, sizeof(xpl_worker_t));
+    w->pool = _p;
+    w->index = i;
+    memcpy(&w->context, _s, sizeof(xpl_context_t));
+    w->context.own_registry = NULL;
+#ifdef XPL_ENABLE_PROFILER
+    w->context.profile = NULL;
+#endif /* XPL_ENABLE_PROFILER */
+#ifdef XPL_ENABLE_TRACE
+    w->context.trace = NULL;
+#endif /* XPL_ENABLE_TRACE */
+    w->context.scratch = NULL;
+    w->context.scratch_size = w->context.scratch_used = 0;
+    _XPL_MUTEX_INIT(&w->lock);
+  }
+  for(i = 0; i < _n; i++) {
+    w = &_w[i];
+#if defined(_WIN32)
+    w->thread = CreateThread(NULL, 0, _xpl_pool_entry, w, 0, NULL);
+    if(!w->thread) break;
+#else
+    if(pthread_create(&w->thread, NULL, _xpl_pool_entry, w) != 0) break;
+#endif
+    if(_a) _xpl_pool_pin(w);
+  }
+  if(i < _n) {
+    for(_p->workers_count = i; i < _n; i++)
+      _XPL_MUTEX_FREE(&_w[i].lock);
+    xpl_pool_close(_p);
+
+    return XS_ERR;
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_close(xpl_pool_t* _p) {
+  int i = 0;
+  xpl_assert(_p && _p->workers);
+  _XPL_LOCK(&_p->lock);
+  _p->stopping = 1;
+  _XPL_BROADCAST(&_p->wake);
+  _XPL_UNLOCK(&_p->lock);
+  for(i = 0; i < _p->workers_count; i++) {
+#if defined(_WIN32)
+    WaitForSingleObject(_p->workers[i].thread, INFINITE);
+    CloseHandle(_p->workers[i].thread);
+#else
+    pthread_join(_p->workers[i].thread, NULL);
+#endif
+  }
+  for(i = 0; i < _p->workers_count; i++)
+    _XPL_MUTEX_FREE(&_p->workers[i].lock);
+  _XPL_COND_FREE(&_p->idle);
+  _XPL_COND_FREE(&_p->wake);
+  _XPL_MUTEX_FREE(&_p->lock);
+  memset(_p, 0, sizeof(xpl_pool_t));
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_submit(xpl_pool_t* _p, xpl_job_t* _j) {
+  xpl_worker_t* w = NULL;
+  xpl_assert(_p && _p->workers && _j && _j->text);
+  _XPL_LOCK(&_p->lock);
+  if(_p->stopping) { _XPL_UNLOCK(&_p->lock); return XS_ERR; }
+  w = &_p->workers[_p->next];
+  if(++_p->next == _p->workers_count) _p->next = 0;
+  _p->outstanding++;
+  _j->status = XS_OK;
+  _j->worker = -1;
+  /* Links under the pool lock, so a job is visible once it is counted. */
+  _XPL_LOCK(&w->lock);
+  _j->prev = NULL;
+  _j->next = w->head;
+  if(w->head) w->head->prev = _j;
+  else w->tail = _j;
+  w->head = _j;
+  _XPL_UNLOCK(&w->lock);
+  _p->submits++;
+  _XPL_BROADCAST(&_p->wake);
+  _XPL_UNLOCK(&_p->lock);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_wait(xpl_pool_t* _p) {
+  xpl_assert(_p && _p->workers);
+  _XPL_LOCK(&_p->lock);
+  while(_p->outstanding)
+    _XPL_WAIT(&_p->idle, &_p->lock);
+  _XPL_UNLOCK(&_p->lock);
+
+  return XS_OK;
+}
+#endif /* XPL_ENABLE_POOL */
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+XPLAPI xpl_status_t xpl_script_cache_open(xpl_script_cache_t* _c, size_t _m) {
+  xpl_assert(_c);
+  memset(_c, 0, sizeof(xpl_script_cache_t));
+  _c->capacity = _m;
+  _XPL_MUTEX_INIT(&_c->lock);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_script_cache_close(xpl_script_cache_t* _c) {
+  xpl_prepared_t* p = NULL;
+  xpl_assert(_c);
+  while((p = _c->head) != NULL) {
+    xpl_assert(!p->refs && "Prepared script still in use");
+    _xpl_prepared_unlink(_c, p);
+    XPL_FREE(p);
+  }
+  _XPL_MUTEX_FREE(&_c->lock);
+  memset(_c, 0, sizeof(xpl_script_cache_t));
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_load_cached(xpl_context_t* _s, xpl_script_cache_t* _c, const char* _t, size_t _l) {
+  xpl_status_t ret = XS_OK;
+  xpl_prepared_t* p = NULL;
+  xpl_prepared_t* q = NULL;
+  xpl_uint64_t h = 0;
+  xpl_assert(_s && _c && _t);
+  h = _xpl_hash_text(_t, _l);
+  _XPL_LOCK(&_c->lock);
+  if((p = _xpl_prepared_find(_c, _s, h, _t, _l)) != NULL) {
+    p->refs++;
+    _c->stats.hits++;
+  } else {
+    _c->stats.misses++;
+  }
+  _XPL_UNLOCK(&_c->lock);
+  if(!p) {
+    xpl_load_n(_s, _t, _l);
+    if((ret = _xpl_prepare(_s, _c, h, &p)) != XS_OK) return ret;
+    _XPL_LOCK(&_c->lock);
+    if((q = _xpl_prepared_find(_c, _s, h, _t, _l)) != NULL) {
+      q->refs++;
+    } else {
+      p->refs = 1;
+      p->chain = _c->buckets[h & (XPL_SCRIPT_CACHE_BUCKETS - 1)];
+      _c->buckets[h & (XPL_SCRIPT_CACHE_BUCKETS - 1)] = p;
+      p->next = _c->head;
+      if(_c->head) _c->head->prev = p;
+      else _c->tail = p;
+      _c->head = p;
+      _c->stats.entries++;
+      _c->stats.size += p->size;
+      _xpl_script_cache_trim(_c);
+    }
+    _XPL_UNLOCK(&_c->lock);
+    if(q) {
+      XPL_FREE(p);
+      p = q;
+    }
+  }
+  xpl_load_n(_s, p->text, p->length);
+  _s->prepared = p;
+  _s->program = &p->program;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_script_cache_stats(xpl_script_cache_t* _c, xpl_script_cache_stats_t* _o) {
+  xpl_assert(_c && _o);
+  _XPL_LOCK(&_c->lock);
+  memcpy(_o, &_c->stats, sizeof(xpl_script_cache_stats_t));
+  _XPL_UNLOCK(&_c->lock);
+
+  return XS_OK;
+}
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s) {
+  xpl_if_frame_t* frame = NULL;
+  xpl_assert(_s && _s->text);
+  if(_s->if_statement_depth >= XPL_IF_STACK_SIZE) return XS_ERR;
+  frame = &_s->if_frames[_s->if_statement_depth++];
+  frame->outer_lanes = frame->remaining_lanes = _s->active_lanes;
+  frame->taken = 0;
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s) {
+  xpl_if_frame_t* frame = NULL;
+  xpl_lanes_t lanes = 0;
+  xpl_assert(_s && _s->text);
+  if(!_s->if_statement_depth) return XS_ERR;
+  frame = &_s->if_frames[_s->if_statement_depth - 1];
+  if(frame->taken) return XS_ERR;
+  lanes = _s->bool_value & frame->remaining_lanes;
+#ifdef XPL_ENABLE_PROFILER
+  if(_s->profile && !_s->reader) _xpl_profile_branch(_s, (int)(_s->cursor - _s->text), lanes != 0);
+#endif /* XPL_ENABLE_PROFILER */
+  _XPL_TRACE(_s, lanes ? XTK_TAKEN : XTK_SKIPPED, NULL, (int)(_s->cursor - _s->text), XS_OK);
+  if(lanes) {
+    _s->active_lanes = lanes;
+    frame->remaining_lanes &= ~lanes;
+    frame->taken = 1;
+  }
+  _s->bool_value = 0;
+  _s->bool_composing = XBC_NIL;
+  if(lanes) return XS_OK;
+  _s->skip_kind = XSK_BRANCH;
+
+  return _xpl_skip_resume(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s) {
+  xpl_if_frame_t* frame = NULL;
+  xpl_assert(_s && _s->text);
+  if(!_s->if_statement_depth) return XS_ERR;
+  frame = &_s->if_frames[_s->if_statement_depth - 1];
+  if(!frame->taken) return XS_ERR;
+  if(frame->remaining_lanes) {
+    _s->active_lanes = frame->remaining_lanes;
+    frame->taken = 0;
+  } else {
+    _s->active_lanes = frame->outer_lanes;
+
+    return _xpl_skip_to_endif(_s);
+  }
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s) {
+  xpl_if_frame_t* frame = NULL;
+  xpl_assert(_s && _s->text);
+  if(!_s->if_statement_depth) return XS_ERR;
+  frame = &_s->if_frames[_s->if_statement_depth - 1];
+  if(!frame->taken) return XS_ERR;
+  if(frame->remaining_lanes) {
+    _s->active_lanes = frame->remaining_lanes;
+    frame->remaining_lanes = 0;
+  } else {
+    _s->active_lanes = frame->outer_lanes;
+
+    return _xpl_skip_to_endif(_s);
+  }
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  if(!_s->if_statement_depth) return XS_ERR;
+  _s->active_lanes = _s->if_frames[_s->if_statement_depth - 1].outer_lanes;
+  _s->if_statement_depth--;
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_or(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  _s->bool_composing = XBC_OR;
+  if(_xpl_bool_known(_s)) _xpl_skip_predicate(_s);
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_and(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  _s->bool_composing = XBC_AND;
+  if(_xpl_bool_known(_s)) _xpl_skip_predicate(_s);
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_yield(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+
+  return XS_SUSPENT;
+}
+
+XPLINTERNAL int _xpl_skip_ifcond_body(xpl_context_t* _s) {
+  const xpl_func_info_t* func = NULL;
+  const char* src = NULL;
+  int to = 0;
+  int out = 0;
+  xpl_assert(_s && _s->text);
+  if(!_s->skip_body) {
+    XPL_SKIP_MEANINGLESS(_s);
+    _XPL_TRACE(_s, XTK_SKIP_BEGIN, NULL, (int)(_s->cursor - _s->text), XS_OK);
+    _s->skip_key = (int)((_s->cursor - _s->text) << 1) + 1;
+    if(!_s->reader && _xpl_branch_cache_get(_s, _s->skip_key, &to)) {
+      _s->cursor = _s->text + to;
+      _XPL_TRACE(_s, XTK_SKIP_END, NULL, to, XS_OK);
+
+      return 1;
+    }
+    _s->skip_nest = 0;
+    _s->skip_body = 1;
+  }
+  do {
+    _xpl_stream_sync(_s);
+    if(_s->reader) _xpl_stream_statement(_s);
+    XPL_SKIP_MEANINGLESS(_s);
+    if(_s->cursor >= _s->text_end) break;
+    if(_xpl_is_comma(*(unsigned char*)_s->cursor)) { _s->cursor++; continue; }
+    func = _xpl_find_func(_s, _s->cursor);
+    if(!func) {
+      src = _s->cursor;
+      xpl_skip_string(_s);
+      if(_s->cursor == src) _s->cursor++;
+      continue;
+    } else if(func->func == _xpl_core_if) {
+      _s->skip_nest++;
+    } else if(func->func == _xpl_core_elseif || func->func == _xpl_core_else || func->func == _xpl_core_endif) {
+      if(!_s->skip_nest) break;
+      else if(func->func == _xpl_core_endif) _s->skip_nest--;
+    }
+    _s->cursor += func->length;
+  } while(_xpl_has_more(_s) && !(out = _xpl_budget_out(_s)));
+  if(out) return 0;
+  _s->skip_body = 0;
+  if(!_s->reader) _xpl_branch_cache_set(_s, _s->skip_key, (int)(_s->cursor - _s->text));
+  _XPL_TRACE(_s, XTK_SKIP_END, NULL, (int)(_s->cursor - _s->text), XS_OK);
+
+  return 1;
+}
+
+XPLINTERNAL xpl_status_t _xpl_skip_to_endif(xpl_context_t* _s) {
+  int to = 0;
+  xpl_assert(_s && _s->text);
+  _s->skip_endif_key = (int)((_s->cursor - _s->text) << 1) + 2;
+  if(!_s->reader && _xpl_branch_cache_get(_s, _s->skip_endif_key, &to)) {
+    _s->cursor = _s->text + to;
+    _s->if_statement_depth--;
+
+    return XS_OK;
+  }
+  _s->skip_kind = XSK_ENDIF;
+
+  return _xpl_skip_resume(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_skip_resume(xpl_context_t* _s) {
+  const xpl_func_info_t* func = NULL;
+  xpl_if_frame_t* frame = NULL;
+  xpl_assert(_s && _s->text && _s->if_statement_depth);
+  frame = &_s->if_frames[_s->if_statement_depth - 1];
+  while(_s->skip_kind != XSK_NONE) {
+    if(!_xpl_skip_ifcond_body(_s)) return XS_PREEMPTED;
+    _xpl_stream_sync(_s);
+    _xpl_peek_func(_s, &func);
+    if(func) _s->cursor += func->length;
+    if(_s->skip_kind == XSK_BRANCH) {
+      if(func && func->func == _xpl_core_else) {
+        frame->remaining_lanes = 0;
+        frame->taken = 1;
+      } else if(func && func->func == _xpl_core_endif) {
+        _s->active_lanes = frame->outer_lanes;
+        _s->if_statement_depth--;
+      }
+      _s->skip_kind = XSK_NONE;
+    } else if((func && func->func == _xpl_core_endif) || !_xpl_has_more(_s)) {
+      _s->if_statement_depth--;
+      if(!_s->reader) _xpl_branch_cache_set(_s, _s->skip_endif_key, (int)(_s->cursor - _s->text));
+      _s->skip_kind = XSK_NONE;
+    }
+  }
+
+  return XS_OK;
+}
+
+XPLINTERNAL int _xpl_budget_out(xpl_context_t* _s) {
+  if(_s->budget < 0) return 0;
+  if(!_s->budget) return 1;
+  _s->budget--;
+  if(_s->clock && !(_s->budget & (XPL_DEADLINE_INTERVAL - 1)) && _s->clock(_s->clock_userdata) >= _s->deadline) {
+    _s->budget = 0;
+
+    return 1;
+  }
+
+  return 0;
+}
+
+XPLINTERNAL xpl_status_t _xpl_run_budgeted(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  for(;;) {
+    if(_s->program) {
+      if(_s->pc >= _s->program->instrs_count) break;
+    } else if(!_s->skip_kind && !_xpl_has_more(_s)) {
+      break;
+    }
+    if(_xpl_budget_out(_s)) { ret = XS_PREEMPTED; break; }
+    ret = _s->program ? xpl_step_compiled(_s) : xpl_step(_s);
+    if(ret != XS_OK) break;
+  }
+  _s->budget = -1;
+  _s->clock = NULL;
+
+  return ret;
+}
+
+XPLINTERNAL xpl_status_t _xpl_map_file(const char* _p, xpl_access_hint_t _a, void** _v, size_t* _l) {
+#if defined(XPL_NO_MMAP)
+  xpl_assert(_p && _v && _l);
+  (void)_a;
+
+  return XS_ERR;
+#elif defined(_WIN32)
+  HANDLE f = INVALID_HANDLE_VALUE;
+  HANDLE m = NULL;
+  LARGE_INTEGER size;
+  void* view = NULL;
+  xpl_assert(_p && _v && _l);
+  *_v = NULL;
+  *_l = 0;
+  f = CreateFileA(_p, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, _a == XAH_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+  if(f == INVALID_HANDLE_VALUE) return XS_ERR;
+  if(!GetFileSizeEx(f, &size)) { CloseHandle(f); return XS_ERR; }
+  if(size.QuadPart == 0) { CloseHandle(f); return XS_OK; }
+  m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(f);
+  if(!m) return XS_ERR;
+  view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(m);
+  if(!view) return XS_ERR;
+  *_v = view;
+  *_l = (size_t)size.QuadPart;
+
+  return XS_OK;
+#else
+  struct stat st;
+  void* view = NULL;
+  int fd = -1;
+  xpl_assert(_p && _v && _l);
+  *_v = NULL;
+  *_l = 0;
+  fd = open(_p, O_RDONLY);
+  if(fd < 0) return XS_ERR;
+  if(fstat(fd, &st) != 0) { close(fd); return XS_ERR; }
+  if(st.st_size == 0) { close(fd); return XS_OK; }
+  view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(view == MAP_FAILED) return XS_ERR;
+#if defined(POSIX_MADV_SEQUENTIAL)
+  if(_a == XAH_SEQUENTIAL) posix_madvise(view, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+  else if(_a == XAH_WILLNEED) posix_madvise(view, (size_t)st.st_size, POSIX_MADV_WILLNEED);
+#elif defined(MADV_SEQUENTIAL)
+  if(_a == XAH_SEQUENTIAL) madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+  else if(_a == XAH_WILLNEED) madvise(view, (size_t)st.st_size, MADV_WILLNEED);
+#else
+  (void)_a;
+#endif
+  *_v = view;
+  *_l = (size_t)st.st_size;
+
+  return XS_OK;
+#endif
+}
+
+XPLINTERNAL void _xpl_unmap_file(void* _v, size_t _l) {
+  if(!_v) return;
+#if defined(XPL_NO_MMAP)
+  (void)_l;
+#elif defined(_WIN32)
+  (void)_l;
+  UnmapViewOfFile(_v);
+#else
+  munmap(_v, _l);
+#endif
+}
+
+XPLINTERNAL void _xpl_image_header(xpl_context_t* _s, xpl_image_header_t* _h) {
+  const xpl_registry_t* r = _s->registry;
+  const char* p = NULL;
+  unsigned h = 2166136261u;
+  int i = 0;
+  memset(_h, 0, sizeof(xpl_image_header_t));
+  _h->magic = XPL_IMAGE_MAGIC;
+  _h->version = XPL_IMAGE_VERSION;
+  _h->instr_size = (unsigned)sizeof(xpl_instr_t);
+  _h->literal_size = (unsigned)sizeof(xpl_literal_t);
+  _h->escape_mode = !_s->escape_detect ? 0 : _xpl_is_builtin_escape(_s) ? 1 : 2;
+  for(i = 0; i < r->funcs_count; i++) {
+    for(p = r->funcs[i].name; *p; p++) h = (h ^ *(unsigned char*)p) * 16777619u;
+    h = (h ^ 0xffu) * 16777619u;
+  }
+  _h->registry_hash = h & 0xffffffffu;
+  h = 2166136261u;
+  for(p = _s->text; p < _s->text_end; p++) h = (h ^ *(unsigned char*)p) * 16777619u;
+  _h->text_hash = h & 0xffffffffu;
+  _h->text_length = (int)(_s->text_end - _s->text);
+}
+
+XPLINTERNAL size_t _xpl_image_literals_at(int _n) {
+  return (sizeof(xpl_image_header_t) + (size_t)_n * sizeof(xpl_instr_t) + sizeof(double) - 1) & ~(sizeof(double) - 1);
+}
+
+XPLINTERNAL int _xpl_translate_label(const xpl_func_info_t* _f, const xpl_instr_t* _c, int _n, int _j) {
+  xpl_func_t f = NULL;
+  int i = 0;
+  if(_j == _n) return 1;
+  f = _f[_c[_j - 1].func].func;
+  if(f != _xpl_core_then && f != _xpl_core_elseif && f != _xpl_core_else &&
+    f != _xpl_core_endif && f != _xpl_core_or && f != _xpl_core_and)
+    return 1;
+  for(i = 0; i < _n; i++) {
+    f = _f[_c[i].func].func;
+    if((f == _xpl_core_then || f == _xpl_core_elseif || f == _xpl_core_else) && _c[i].jump + 1 == _j) return 1;
+    if((f == _xpl_core_or || f == _xpl_core_and) && i + 2 == _j && _xpl_func_skippable(&_f[_c[i + 1].func])) return 1;
+  }
+
+  return 0;
+}
+
+XPLINTERNAL void _xpl_translate_text(FILE* _fp, const char* _t, const char* _e) {
+  unsigned char c = 0;
+  int col = 0;
+  fputs("  \"", _fp);
+  for(; _t < _e; _t++) {
+    c = *(unsigned char*)_t;
+    if(col >= 64) {
+      fputs("\"\n  \"", _fp);
+      col = 0;
+    }
+    if(c == '"' || c == '\\' || c == '?') { fputc('\\', _fp); fputc(c, _fp); col += 2; }
+    else if(c < ' ' || c >= 0x7f) { fprintf(_fp, "\\%03o", c); col += 4; }
+    else { fputc(c, _fp); col++; }
+  }
+  fputc('"', _fp);
+}
+
+XPLINTERNAL int _xpl_branch_cache_get(xpl_context_t* _s, int _k, int* _t) {
+  int i = (int)(((unsigned)_k * 2654435761u) >> 16) & (XPL_BRANCH_CACHE_SIZE - 1);
+  if(_s->branch_from[i] != _k) return 0;
+  *_t = _s->branch_to[i];
+
+  return 1;
+}
+
+XPLINTERNAL void _xpl_branch_cache_set(xpl_context_t* _s, int _k, int _t) {
+  int i = (int)(((unsigned)_k * 2654435761u) >> 16) & (XPL_BRANCH_CACHE_SIZE - 1);
+  _s->branch_from[i] = _k;
+  _s->branch_to[i] = _t;
+}
+
+XPLINTERNAL int _xpl_bool_known(xpl_context_t* _s) {
+  switch(_s->bool_composing) {
+    case XBC_OR: return _s->bool_value == _s->active_lanes;
+    case XBC_AND: return !_s->bool_value;
+    default: return 0;
+  }
+}
 
-/* ========================================================} */
+XPLINTERNAL int _xpl_func_skippable(const xpl_func_info_t* _f) {
+  xpl_func_t f = _f->func;
+  if(_f->flags & XFF_SIDE_EFFECT) return 0;
 
-/*
-** {========================================================
-** Function definitions
-*/
+  return f != _xpl_core_if && f != _xpl_core_then && f != _xpl_core_elseif && f != _xpl_core_else &&
+    f != _xpl_core_endif && f != _xpl_core_or && f != _xpl_core_and && f != _xpl_core_yield;
+}
 
-XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_func_info_t* _f, xpl_is_separator_func _is) {
-  xpl_assert(_s && _f);
-  memset(_s, 0, sizeof(xpl_context_t));
-  _s->funcs = _f;
-  while(_f[_s->funcs_count].name && _f[_s->funcs_count].func)
-    _s->funcs_count++;
-  qsort(_f, _s->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_srt_cmp);
-  _s->separator_detect = _is;
-  _s->use_hack_pfunc = 1;
+XPLINTERNAL void _xpl_skip_predicate(xpl_context_t* _s) {
+  const xpl_func_info_t* func = NULL;
+  do {
+    _xpl_stream_sync(_s);
+    if(_s->reader && _xpl_stream_statement(_s) != XS_OK) return;
+    if(_xpl_peek_func(_s, &func) != XS_OK) return;
+  } while(!func && _xpl_has_more(_s));
+  if(!func || !_xpl_func_skippable(func)) return;
+  _s->cursor += func->length;
+  XPL_SKIP_MEANINGLESS(_s);
+  while(xpl_has_param(_s) == XS_OK)
+    xpl_skip_string(_s);
+}
 
-  return XS_OK;
+XPLINTERNAL xpl_status_t _xpl_call_pure(xpl_context_t* _s, const xpl_func_info_t* _f, const char* _e) {
+  xpl_status_t ret = XS_OK;
+  xpl_bool_composing_t composing = _s->bool_composing;
+  xpl_lanes_t value = _s->bool_value;
+  xpl_memo_t* memo = NULL;
+  const char* site = _s->cursor;
+  const char* p = site;
+  int k = ~(int)(site - _s->text);
+  int to = 0;
+  int l = 0;
+  unsigned h = 2166136261u ^ (unsigned)(size_t)_f;
+  if(!_e && _xpl_branch_cache_get(_s, k, &to)) {
+    _e = _s->text + to;
+  } else if(!_e) {
+    while(xpl_has_param(_s) == XS_OK)
+      xpl_skip_string(_s);
+    _e = _s->cursor;
+    _s->cursor = site;
+    _xpl_branch_cache_set(_s, k, (int)(_e - _s->text));
+  }
+  l = (int)(_e - site);
+  for(; p < _e; p++) h = (h ^ *(unsigned char*)p) * 16777619u;
+  memo = &_s->memo[h & (XPL_MEMO_SIZE - 1)];
+  if(memo->epoch == _s->memo_epoch && memo->func == _f && memo->hash == h && memo->params_length == l &&
+    !(_s->active_lanes & ~memo->lanes) && (memo->params == site || !memcmp(memo->params, site, l))) {
+    _s->cursor = _e;
+
+    return xpl_push_lanes(_s, memo->value);
+  }
+  memo->params = site;
+  _s->bool_composing = XBC_NIL;
+  _s->bool_value = 0;
+  ret = _f->func(_s);
+  _s->cursor = _e;
+  memo->value = _s->bool_value;
+  _s->bool_composing = composing;
+  _s->bool_value = value;
+  if(ret != XS_OK) { memo->epoch = _s->memo_epoch - 1; return ret; }
+  memo->func = _f;
+  memo->params_length = l;
+  memo->hash = h;
+  memo->epoch = _s->memo_epoch;
+  memo->lanes = _s->active_lanes;
+
+  return xpl_push_lanes(_s, memo->value);
 }
 
-XPLAPI xpl_status_t xpl_close(xpl_context_t* _s) {
-  xpl_assert(_s);
-  if(_s->use_hack_pfunc)
-    printf("XPL closed, pfunc_hack code: %d\n", _s->pfunc_hack);
-  memset(_s, 0, sizeof(xpl_context_t));
+XPLINTERNAL xpl_status_t _xpl_call(xpl_context_t* _s, const xpl_func_info_t* _f, const char* _e) {
+  if((_f->flags & XFF_PURE) && !_s->reader) return _xpl_call_pure(_s, _f, _e);
 
-  return XS_OK;
+  return _f->func(_s);
 }
 
-XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t) {
-  xpl_assert(_s && _t);
-  if(_s->text) xpl_unload(_s);
-  _s->cursor = _s->text = _t;
+XPLINTERNAL void _xpl_stream_fill(xpl_context_t* _s, int _f) {
+  char* w = _s->window;
+  int rest = (int)(_s->text_end - _s->cursor);
+  int want = _f ? _s->window_size - 1 : (_s->window_size - 1) / 2;
+  int n = 0;
+  if(_s->stream_eof || rest >= want) return;
+  memmove(w, _s->cursor, rest);
+  _s->cursor = w;
+  _s->text_end = w + rest;
+  while(rest < want) {
+    n = (*_s->reader)(_s->reader_userdata, w + rest, _s->window_size - 1 - rest);
+    if(n <= 0) { _s->stream_eof = 1; break; }
+    rest += n;
+  }
+  w[rest] = '\0';
+  _s->text_end = w + rest;
+}
 
-  return XS_OK;
+XPLINTERNAL void _xpl_stream_sync(xpl_context_t* _s) {
+  if(!_s->reader) return;
+  for(;;) {
+    _xpl_stream_fill(_s, 0);
+    if(_s->stream_in_comment) {
+      _s->cursor = _xpl_scan_char(_s->cursor, _s->text_end, '\'');
+      if(_s->cursor < _s->text_end && _xpl_is_squote(*(unsigned char*)_s->cursor)) { _s->cursor++; _s->stream_in_comment = 0; }
+      else if(_s->stream_eof) _s->stream_in_comment = 0;
+    }
+    XPL_SKIP_MEANINGLESS(_s);
+    if(_s->cursor < _s->text_end || _s->stream_eof) break;
+  }
+  _xpl_stream_fill(_s, 0);
 }
 
-XPLAPI xpl_status_t xpl_reload(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  _s->cursor = _s->text;
+XPLINTERNAL xpl_status_t _xpl_stream_statement(xpl_context_t* _s) {
+  const xpl_func_info_t* func = NULL;
+  const char* begin = NULL;
+  int in_comment = 0;
+  int done = 0;
+  int full = 0;
+  for(;;) {
+    begin = _s->cursor;
+    in_comment = _s->stream_in_comment;
+    if(_xpl_peek_func(_s, &func) == XS_OK && func) {
+      _s->cursor += func->length;
+      XPL_SKIP_MEANINGLESS(_s);
+    }
+    while(xpl_has_param(_s) == XS_OK)
+      xpl_skip_string(_s);
+    done = _s->cursor < _s->text_end || _s->stream_eof;
+    _s->cursor = begin;
+    _s->stream_in_comment = in_comment;
+    if(done) return XS_OK;
+    if(full) return XS_NO_ENOUGH_BUFFER_SIZE;
+    _xpl_stream_fill(_s, 1);
+    full = 1;
+  }
+}
 
-  return XS_OK;
+XPLINTERNAL int _xpl_has_more(xpl_context_t* _s) {
+  return _s->cursor < _s->text_end || (_s->reader && !_s->stream_eof);
 }
 
-XPLAPI xpl_status_t xpl_unload(xpl_context_t* _s) {
-  xpl_assert(_s);
-  _s->cursor = _s->text = NULL;
+#if defined(XPL_ENABLE_PROFILER) || defined(XPL_ENABLE_TRACE)
+XPLINTERNAL xpl_uint64_t _xpl_ticks(void) {
+#if defined(XPL_TICKS_RDTSC)
+  return (xpl_uint64_t)__rdtsc();
+#elif defined(__GNUC__) && defined(__aarch64__)
+  xpl_uint64_t v = 0;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
 
-  return XS_OK;
+  return v;
+#elif defined(_WIN32)
+  LARGE_INTEGER c;
+  QueryPerformanceCounter(&c);
+
+  return (xpl_uint64_t)c.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (xpl_uint64_t)ts.tv_sec * 1000000000u + (xpl_uint64_t)ts.tv_nsec;
+#else
+  return (xpl_uint64_t)clock();
+#endif
 }
 
-XPLAPI xpl_status_t xpl_run(xpl_context_t* _s) {
+XPLINTERNAL void _xpl_write_json_string(FILE* _fp, const char* _t) {
+  unsigned char c = 0;
+  fputc('"', _fp);
+  for(; (c = (unsigned char)*_t) != '\0'; _t++) {
+    if(c == '"' || c == '\\') { fputc('\\', _fp); fputc(c, _fp); }
+    else if(c == '\n') fputs("\\n", _fp);
+    else if(c == '\r') fputs("\\r", _fp);
+    else if(c == '\t') fputs("\\t", _fp);
+    else if(c < ' ' || c == 0x7f) fprintf(_fp, "\\u%04x", c);
+    else fputc(c, _fp);
+  }
+  fputc('"', _fp);
+}
+#endif /* XPL_ENABLE_PROFILER || XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_TRACE
+XPLINTERNAL double _xpl_ticks_per_us(void) {
+#if defined(XPL_TICKS_RDTSC)
+  return 0.0;
+#elif defined(__GNUC__) && defined(__aarch64__)
+  xpl_uint64_t f = 0;
+  __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(f));
+
+  return (double)f / 1e6;
+#elif defined(_WIN32)
+  LARGE_INTEGER f;
+  QueryPerformanceFrequency(&f);
+
+  return (double)f.QuadPart / 1e6;
+#elif defined(CLOCK_MONOTONIC)
+  return 1e3;
+#else
+  return (double)CLOCKS_PER_SEC / 1e6;
+#endif
+}
+
+XPLINTERNAL double _xpl_ref_us(void) {
+#if defined(_WIN32)
+  LARGE_INTEGER f;
+  LARGE_INTEGER c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+
+  return (double)c.QuadPart * 1e6 / (double)f.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+#else
+  return (double)clock() * 1e6 / CLOCKS_PER_SEC;
+#endif
+}
+#endif /* XPL_ENABLE_TRACE */
+
+#ifdef XPL_ENABLE_PROFILER
+XPLINTERNAL xpl_status_t _xpl_profile_call(xpl_context_t* _s, const xpl_func_info_t* _f, const char* _e) {
   xpl_status_t ret = XS_OK;
-  xpl_assert(_s && _s->text && "Empty program");
-  while(*_s->cursor && ret == XS_OK)
-    ret = xpl_step(_s);
+  xpl_profile_t* p = _s->profile;
+  xpl_prof_func_t* f = &p->funcs[_f - _s->registry->funcs];
+  xpl_uint64_t nested = p->nested;
+  xpl_uint64_t t = 0;
+  p->nested = 0;
+  t = _xpl_ticks();
+  ret = _xpl_call(_s, _f, _e);
+  t = _xpl_ticks() - t;
+  f->calls++;
+  f->inclusive += t;
+  f->exclusive += t > p->nested ? t - p->nested : 0;
+  p->nested = nested + t;
 
   return ret;
 }
 
-XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f) {
-  xpl_status_t ret = XS_OK;
-  xpl_func_info_t* func = NULL;
-  xpl_assert(_s && _s->text);
-  XPL_SKIP_MEANINGLESS(_s);
-  if(_f) *_f = NULL;
-  if(_xpl_is_comma(*(unsigned char*)_s->cursor)) {
-    _s->cursor++;
-  } else {
-    func = (xpl_func_info_t*)bsearch(_s->cursor, _s->funcs, _s->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_sch_cmp);
-    if(!func) return XS_ERR;
-    if(_f) *_f = func;
+XPLINTERNAL void _xpl_profile_branch(xpl_context_t* _s, int _o, int _t) {
+  xpl_profile_t* p = _s->profile;
+  xpl_prof_branch_t* b = NULL;
+  int i = 0;
+  int n = 0;
+  if(!p->branches_size) return;
+  i = (int)(((unsigned)_o * 2654435761u) % (unsigned)p->branches_size);
+  for(n = 0; n < p->branches_size; n++) {
+    b = &p->branches[i];
+    if(b->offset == _o) break;
+    if(b->offset < 0) {
+      b->offset = _o;
+      p->branches_count++;
+      break;
+    }
+    if(++i == p->branches_size) i = 0;
   }
+  if(n == p->branches_size) return;
+  if(_t) b->taken++;
+  else b->skipped++;
+}
+#endif /* XPL_ENABLE_PROFILER */
 
-  return ret;
+#ifdef XPL_ENABLE_TRACE
+XPLINTERNAL void _xpl_trace_emit(xpl_context_t* _s, xpl_trace_kind_t _k, const xpl_func_info_t* _f, int _o, xpl_status_t _r) {
+  xpl_trace_ring_t* r = _s->trace;
+  xpl_trace_event_t* e = NULL;
+  unsigned head = r->head;
+  if(head - _XPL_LOAD_ACQUIRE(&r->tail) >= r->size) { r->dropped++; return; }
+  e = &r->events[head & (r->size - 1)];
+  e->ticks = _xpl_ticks();
+  e->offset = _o;
+  e->func = _f ? (int)(_f - _s->registry->funcs) : -1;
+  e->kind = (unsigned char)_k;
+  e->status = (unsigned char)_r;
+  _XPL_STORE_RELEASE(&r->head, head + 1);
 }
+#endif /* XPL_ENABLE_TRACE */
 
-XPLAPI xpl_status_t xpl_step(xpl_context_t* _s) {
-  xpl_status_t ret = XS_OK;
-  xpl_func_info_t* func = NULL;
-  xpl_assert(_s && _s->text);
-  if((ret = xpl_peek_func(_s, &func)) != XS_OK) return ret;
-  if(!func) return ret;
-  _s->cursor += strlen(func->name);
-  XPL_SKIP_MEANINGLESS(_s);
-  if((ret = func->func(_s)) != XS_OK) return ret;
+#ifdef XPL_ENABLE_POOL
+XPLINTERNAL xpl_job_t* _xpl_pool_take(xpl_worker_t* _w) {
+  xpl_pool_t* p = _w->pool;
+  xpl_worker_t* v = NULL;
+  xpl_job_t* job = NULL;
+  int i = 0;
+  _XPL_LOCK(&_w->lock);
+  if((job = _w->head)) {
+    _w->head = job->next;
+    if(_w->head) _w->head->prev = NULL;
+    else _w->tail = NULL;
+  }
+  _XPL_UNLOCK(&_w->lock);
+  for(i = 1; !job && i < p->workers_count; i++) {
+    v = &p->workers[(_w->index + i) % p->workers_count];
+    _XPL_LOCK(&v->lock);
+    if((job = v->tail)) {
+      v->tail = job->prev;
+      if(v->tail) v->tail->next = NULL;
+      else v->head = NULL;
+    }
+    _XPL_UNLOCK(&v->lock);
+  }
 
-  return ret;
+  return job;
 }
 
-XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  if(_xpl_is_squote(*(unsigned char*)_s->cursor)) {
-    do {
-      _s->cursor++;
-    } while(*(unsigned char*)_s->cursor != '\0' && !_xpl_is_squote(*(unsigned char*)_s->cursor));
-    _s->cursor++;
+XPLINTERNAL void _xpl_pool_run(xpl_worker_t* _w, xpl_job_t* _j) {
+  xpl_context_t* s = &_w->context;
+  s->userdata = _j->userdata;
+  xpl_load_n(s, _j->text, _j->length);
+  _j->worker = _w->index;
+  _j->status = xpl_run(s);
+  xpl_unload(s);
+  s->userdata = NULL;
+}
 
-    return XS_OK;
+XPLINTERNAL void _xpl_pool_pin(xpl_worker_t* _w) {
+#if defined(_WIN32)
+  DWORD_PTR proc = 0;
+  DWORD_PTR sys = 0;
+  DWORD_PTR bit = 0;
+  int n = 0;
+  if(!GetProcessAffinityMask(GetCurrentProcess(), &proc, &sys) || !proc) return;
+  for(bit = 1; bit; bit <<= 1) { if(proc & bit) n++; }
+  n = _w->index % n;
+  for(bit = 1; bit; bit <<= 1) {
+    if((proc & bit) && !n--) { SetThreadAffinityMask(_w->thread, bit); break; }
+  }
+#elif defined(__linux__) && defined(CPU_SET)
+  cpu_set_t avail;
+  cpu_set_t one;
+  int n = 0;
+  int i = 0;
+  CPU_ZERO(&avail);
+  if(sched_getaffinity(0, sizeof(avail), &avail) != 0 || !(n = CPU_COUNT(&avail))) return;
+  n = _w->index % n;
+  for(i = 0; i < CPU_SETSIZE; i++) {
+    if(CPU_ISSET(i, &avail) && !n--) {
+      CPU_ZERO(&one);
+      CPU_SET(i, &one);
+      pthread_setaffinity_np(_w->thread, sizeof(one), &one);
+      break;
+    }
   }
+#else
+  (void)_w;
+#endif
+}
 
-  return XS_NO_COMMENT;
+XPLINTERNAL void _xpl_pool_loop(xpl_worker_t* _w) {
+  xpl_pool_t* p = _w->pool;
+  xpl_job_t* job = NULL;
+  unsigned seen = 0;
+  int stop = 0;
+  /* Every job linked before a snapshot of the submit count is found by the
+     next scan, or taken by another worker; so a failed scan only waits for
+     the count to move. */
+  _XPL_LOCK(&p->lock);
+  seen = p->submits;
+  _XPL_UNLOCK(&p->lock);
+  for(;;) {
+    if((job = _xpl_pool_take(_w))) {
+      _xpl_pool_run(_w, job);
+      if(p->done) p->done(job);
+      _XPL_LOCK(&p->lock);
+      if(!--p->outstanding) _XPL_BROADCAST(&p->idle);
+      seen = p->submits;
+      _XPL_UNLOCK(&p->lock);
+      continue;
+    }
+    _XPL_LOCK(&p->lock);
+    while(p->submits == seen && !p->stopping)
+      _XPL_WAIT(&p->wake, &p->lock);
+    stop = p->stopping && p->submits == seen;
+    seen = p->submits;
+    _XPL_UNLOCK(&p->lock);
+    if(stop) break;
+  }
 }
 
-XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s) {
-  xpl_func_info_t* func = NULL;
-  xpl_assert(_s && _s->text);
-  XPL_SKIP_MEANINGLESS(_s);
-  if(_s->cursor[0] == '\0') return XS_NO_PARAM;
-  xpl_peek_func(_s, &func);
+#if defined(_WIN32)
+XPLINTERNAL DWORD WINAPI _xpl_pool_entry(LPVOID _w) {
+  _xpl_pool_loop((xpl_worker_t*)_w);
 
-  return ((_xpl_is_comma(*(unsigned char*)_s->cursor) || func) ? XS_NO_PARAM : XS_OK);
+  return 0;
 }
+#else
+XPLINTERNAL void* _xpl_pool_entry(void* _w) {
+  _xpl_pool_loop((xpl_worker_t*)_w);
 
-XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s) {
-  const char* src = NULL;
-  xpl_assert(_s && _s->text);
-  src = _s->cursor;
-  if(_xpl_is_dquote(*(unsigned char*)src)) {
-    src++;
-    while(!_xpl_is_dquote(*(unsigned char*)src))
-      src++;
-    src++;
-  } else {
-    while(!_xpl_is_separator(*(unsigned char*)src, _s->separator_detect) && *src != '\0')
-      src++;
+  return NULL;
+}
+#endif
+#endif /* XPL_ENABLE_POOL */
+
+#ifdef XPL_ENABLE_SCRIPT_CACHE
+XPLINTERNAL xpl_uint64_t _xpl_hash_text(const char* _t, size_t _l) {
+  const xpl_uint64_t m = ((xpl_uint64_t)0x9e3779b9u << 32) | 0x7f4a7c15u;
+  xpl_uint64_t ret = m ^ (xpl_uint64_t)_l;
+  xpl_uint64_t w = 0;
+  for(; _l >= sizeof(w); _t += sizeof(w), _l -= sizeof(w)) {
+    memcpy(&w, _t, sizeof(w));
+    ret = (ret ^ w) * m;
+    ret ^= ret >> 29;
   }
-  _s->cursor = src;
+  w = 0;
+  memcpy(&w, _t, _l);
+  ret = (ret ^ w) * m;
 
-  return XS_OK;
+  return ret ^ (ret >> 32);
 }
 
-XPLAPI xpl_status_t xpl_pop_long(xpl_context_t* _s, long* _o) {
-  xpl_status_t ret = XS_OK;
-  char* conv_suc = NULL;
-  char buf[32] = { '\0' };
-  xpl_assert(_s && _s->text && _o);
-  if((ret = xpl_pop_string(_s, buf, sizeof(buf))) != XS_OK) return ret;
-  *_o = strtol(buf, &conv_suc, 0);
-  if(*conv_suc != '\0') ret = XS_PARAM_TYPE_ERROR;
+XPLINTERNAL xpl_prepared_t* _xpl_prepared_find(xpl_script_cache_t* _c, xpl_context_t* _s, xpl_uint64_t _h, const char* _t, size_t _l) {
+  xpl_prepared_t* p = _c->buckets[_h & (XPL_SCRIPT_CACHE_BUCKETS - 1)];
+  for(; p; p = p->chain) {
+    if(p->hash == _h && p->length == _l && p->funcs == _s->registry->funcs &&
+      p->separator_detect == _s->separator_detect &&
+      p->escape_detect == _s->escape_detect && p->escape_parse == _s->escape_parse &&
+      !memcmp(p->text, _t, _l))
+      break;
+  }
+  if(p && p != _c->head) {
+    p->prev->next = p->next;
+    if(p->next) p->next->prev = p->prev;
+    else _c->tail = p->prev;
+    p->prev = NULL;
+    p->next = _c->head;
+    _c->head->prev = p;
+    _c->head = p;
+  }
 
-  return ret;
+  return p;
 }
 
-XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o) {
+XPLINTERNAL xpl_status_t _xpl_prepare(xpl_context_t* _s, xpl_script_cache_t* _c, xpl_uint64_t _h, xpl_prepared_t** _o) {
   xpl_status_t ret = XS_OK;
-  char* conv_suc = NULL;
-  char buf[32] = { '\0' };
-  xpl_assert(_s && _s->text && _o);
-  if((ret = xpl_pop_string(_s, buf, sizeof(buf))) != XS_OK) return ret;
-  *_o = strtod(buf, &conv_suc);
-  if(*conv_suc != '\0') ret = XS_PARAM_TYPE_ERROR;
+  xpl_program_t prog;
+  xpl_instr_t* instrs = NULL;
+  xpl_literal_t* literals = NULL;
+  xpl_prepared_t* p = NULL;
+  size_t length = (size_t)(_s->text_end - _s->text);
+  size_t instrs_at = 0;
+  size_t literals_at = 0;
+  size_t text_at = 0;
+  int n = 64;
+  *_o = NULL;
+  do {
+    instrs = (xpl_instr_t*)XPL_MALLOC(n * sizeof(xpl_instr_t));
+    literals = (xpl_literal_t*)XPL_MALLOC(n * sizeof(xpl_literal_t));
+    if(!instrs || !literals) ret = XS_ERR;
+    else ret = xpl_compile_literals(_s, &prog, instrs, n, literals, n);
+    if(ret == XS_NO_ENOUGH_BUFFER_SIZE) {
+      XPL_FREE(instrs);
+      XPL_FREE(literals);
+      n *= 2;
+    }
+  } while(ret == XS_NO_ENOUGH_BUFFER_SIZE);
+  _s->program = NULL;
+  if(ret == XS_OK) {
+    instrs_at = (sizeof(xpl_prepared_t) + sizeof(double) - 1) & ~(sizeof(double) - 1);
+    literals_at = (instrs_at + prog.instrs_count * sizeof(xpl_instr_t) + sizeof(double) - 1) & ~(sizeof(double) - 1);
+    text_at = literals_at + prog.literals_count * sizeof(xpl_literal_t);
+    if(!(p = (xpl_prepared_t*)XPL_MALLOC(text_at + length + 64))) ret = XS_ERR;
+  }
+  if(ret == XS_OK) {
+    memset(p, 0, sizeof(xpl_prepared_t));
+    p->cache = _c;
+    p->hash = _h;
+    p->funcs = _s->registry->funcs;
+    p->separator_detect = _s->separator_detect;
+    p->escape_detect = _s->escape_detect;
+    p->escape_parse = _s->escape_parse;
+    p->text = (char*)p + text_at;
+    p->length = length;
+    p->size = text_at + length + 64;
+    memcpy((char*)p + instrs_at, instrs, prog.instrs_count * sizeof(xpl_instr_t));
+    memcpy((char*)p + literals_at, literals, prog.literals_count * sizeof(xpl_literal_t));
+    memcpy((char*)p + text_at, _s->text, length);
+    memset((char*)p + text_at + length, 0, 64);
+    p->program.instrs = (const xpl_instr_t*)((char*)p + instrs_at);
+    p->program.instrs_count = prog.instrs_count;
+    p->program.literals = (const xpl_literal_t*)((char*)p + literals_at);
+    p->program.literals_count = prog.literals_count;
+    *_o = p;
+  }
+  XPL_FREE(instrs);
+  XPL_FREE(literals);
 
   return ret;
 }
 
-XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l) {
+XPLINTERNAL void _xpl_prepared_unlink(xpl_script_cache_t* _c, xpl_prepared_t* _p) {
+  xpl_prepared_t** b = &_c->buckets[_p->hash & (XPL_SCRIPT_CACHE_BUCKETS - 1)];
+  while(*b != _p)
+    b = &(*b)->chain;
+  *b = _p->chain;
+  if(_p->prev) _p->prev->next = _p->next;
+  else _c->head = _p->next;
+  if(_p->next) _p->next->prev = _p->prev;
+  else _c->tail = _p->prev;
+  _c->stats.entries--;
+  _c->stats.size -= _p->size;
+}
+
+XPLINTERNAL void _xpl_script_cache_trim(xpl_script_cache_t* _c) {
+  xpl_prepared_t* p = _c->tail;
+  xpl_prepared_t* q = NULL;
+  while(p && _c->stats.size > _c->capacity) {
+    q = p->prev;
+    if(!p->refs) {
+      _xpl_prepared_unlink(_c, p);
+      _c->stats.evictions++;
+      XPL_FREE(p);
+    }
+    p = q;
+  }
+}
+
+XPLINTERNAL void _xpl_prepared_release(xpl_prepared_t* _p) {
+  xpl_script_cache_t* c = _p->cache;
+  _XPL_LOCK(&c->lock);
+  if(!--_p->refs) _xpl_script_cache_trim(c);
+  _XPL_UNLOCK(&c->lock);
+}
+#endif /* XPL_ENABLE_SCRIPT_CACHE */
+
+XPLINTERNAL xpl_status_t _xpl_pop_string(xpl_context_t* _s, char* _o, int _l, int* _n) {
+  const xpl_literal_t* lit = NULL;
   const char* src = NULL;
+  const char* end = NULL;
   char* dst = NULL;
+  char esc[4];
+  char* e = NULL;
+  int n = 0;
   xpl_assert(_s && _s->text && _o);
+  if((lit = _xpl_literal_at(_s)) != NULL && !(lit->flags & XLF_ESCAPED)) {
+    n = lit->value_end - lit->value_begin;
+    if(n + 1 > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
+    memcpy(_o, _s->text + lit->value_begin, n);
+    _o[n] = '\0';
+    _s->cursor = _s->text + lit->end;
+    if(_n) *_n = n;
+
+    return XS_OK;
+  }
   src = _s->cursor;
   dst = _o;
-  if(_xpl_is_dquote(*(unsigned char*)src)) {
+  if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src) && !_s->escape_detect) {
+    src++;
+    end = _xpl_scan_char(src, _s->text_end, '"');
+    if(end - src + 1 > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
+    memcpy(dst, src, end - src);
+    dst += end - src;
+    src = end;
+    if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) src++;
+  } else if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src) && _xpl_is_builtin_escape(_s)) {
     src++;
-    while(!_xpl_is_dquote(*(unsigned char*)src)) {
-      if(_s->escape_detect && (*_s->escape_detect)(*(unsigned char*)src)) {
+    for(;;) {
+      end = _xpl_scan_chars(src, _s->text_end, '"', '\\');
+      if(end - src + 1 > _l - (dst - _o)) return XS_NO_ENOUGH_BUFFER_SIZE;
+      memcpy(dst, src, end - src);
+      dst += end - src;
+      src = end;
+      if(src >= _s->text_end || *src != '\\') break;
+      e = esc;
+      if(!_xpl_decode_escape(&e, &src, _s->text_end)) return XS_BAD_ESCAPE_FORMAT;
+      if(e - esc + 1 > _l - (dst - _o)) return XS_NO_ENOUGH_BUFFER_SIZE;
+      memcpy(dst, esc, e - esc);
+      dst += e - esc;
+    }
+    if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) src++;
+  } else if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) {
+    src++;
+    while(src < _s->text_end && *src != '\0' && !_xpl_is_dquote(*(unsigned char*)src)) {
+      if((*_s->escape_detect)(*(unsigned char*)src)) {
         xpl_assert(_s->escape_parse);
+        if(src + 1 >= _s->text_end) return XS_BAD_ESCAPE_FORMAT;
         if(!(*_s->escape_parse)(&dst, &src))
           return XS_BAD_ESCAPE_FORMAT;
       } else {
@@ -692,138 +4527,237 @@ XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l) {
       }
       if(dst + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
     }
-    src++;
+    if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) src++;
   } else {
-    while(!_xpl_is_separator(*(unsigned char*)src, _s->separator_detect) && *src != '\0') {
-      *dst++ = *src++;
-      if(dst + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
-    }
+    end = _xpl_scan_token_end(_s, src);
+    if(end - src + 1 > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
+    memcpy(dst, src, end - src);
+    dst += end - src;
+    src = end;
   }
   _s->cursor = src;
   if(dst + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
+  if(_n) *_n = (int)(dst - _o);
   *dst++ = '\0';
 
   return XS_OK;
 }
 
-XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b) {
-  xpl_assert(_s && _s->text);
-  switch(_s->bool_composing) {
-    case XBC_NIL: _s->bool_value = !!_b; break;
-    case XBC_OR: _s->bool_value |= !!_b; break;
-    case XBC_AND: _s->bool_value &= !!_b; break;
-    default: xpl_assert(!"Unknow boolean composing type"); break;
+XPLINTERNAL void _xpl_literal_parse(xpl_context_t* _s, xpl_literal_t* _v) {
+  const char* src = _s->cursor;
+  const char* b = src;
+  const char* e = NULL;
+  const char* p = NULL;
+  xpl_uint64_t u = 0;
+  int neg = 0;
+  memset(_v, 0, sizeof(xpl_literal_t));
+  xpl_skip_string(_s);
+  e = _s->cursor;
+  if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) {
+    _v->flags |= XLF_QUOTED;
+    b = src + 1;
+    if(e > b && _xpl_is_dquote(*(unsigned char*)(e - 1))) e--;
+    if(_s->escape_detect) {
+      for(p = b; p < e; p++) {
+        if((*_s->escape_detect)(*(unsigned char*)p)) { _v->flags |= XLF_ESCAPED; break; }
+      }
+    }
   }
-
-  return XS_OK;
+  _v->begin = (int)(src - _s->text);
+  _v->end = (int)(_s->cursor - _s->text);
+  _v->value_begin = (int)(b - _s->text);
+  _v->value_end = (int)(e - _s->text);
+  if(_v->flags & XLF_ESCAPED) return;
+  if(_xpl_parse_integer(b, e, &u, &neg) == XS_OK && u <= (((xpl_uint64_t)1 << 63) - 1) + (neg ? 1 : 0)) {
+    _v->integer = neg ? (xpl_int64_t)(0 - u) : (xpl_int64_t)u;
+    _v->flags |= XLF_INT;
+  }
+  if(_xpl_parse_double(b, e, &_v->real) == XS_OK) _v->flags |= XLF_DOUBLE;
+  else _v->real = 0.0;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  _s->if_statement_depth++;
+XPLINTERNAL const xpl_literal_t* _xpl_literal_at(xpl_context_t* _s) {
+  const xpl_program_t* prog = _s->program;
+  int off = 0;
+  if(!prog || !prog->literals) return NULL;
+  off = (int)(_s->cursor - _s->text);
+  while(_s->literal < prog->literals_count && prog->literals[_s->literal].begin < off)
+    _s->literal++;
+  if(_s->literal >= prog->literals_count || prog->literals[_s->literal].begin != off) return NULL;
 
-  return XS_OK;
+  return &prog->literals[_s->literal];
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s) {
-  xpl_status_t ret = XS_OK;
-  xpl_func_info_t* func = NULL;
-  xpl_assert(_s && _s->text);
-  if(_s->bool_value) {
-    _s->bool_value = 0;
-    _s->bool_composing = XBC_NIL;
-    do {
-      if((ret = xpl_peek_func(_s, &func)) != XS_OK) return ret;
-      if(!func) continue;
-      if(func->func == _xpl_core_elseif || func->func == _xpl_core_else) break;
-      else if(func->func == _xpl_core_endif) { _s->if_statement_depth--; break; }
-      _s->cursor += strlen(func->name);
-      XPL_SKIP_MEANINGLESS(_s);
-      if((ret = func->func(_s)) != XS_OK) return ret;
-    } while(*_s->cursor);
-    do {
-      if((ret = xpl_peek_func(_s, &func)) != XS_OK) return ret;
-      if(!func) continue;
-      _s->cursor += strlen(func->name);
-      if(func->func == _xpl_core_endif) { _s->if_statement_depth--; break; }
-    } while(*_s->cursor);
-  } else {
-    _s->bool_value = 0;
-    _s->bool_composing = XBC_NIL;
-    do {
-      _xpl_skip_ifcond_body(_s);
-      xpl_peek_func(_s, &func);
-      if(!func) continue;
-      if(func->func == _xpl_core_elseif || func->func == _xpl_core_else) break;
-      else if(func->func == _xpl_core_endif) { _s->if_statement_depth--; break; }
-      _s->cursor += strlen(func->name);
-    } while(*_s->cursor);
-  }
-
-  return ret;
+XPLINTERNAL int _xpl_is_builtin_escape(const xpl_context_t* _s) {
+  return _s->escape_detect == xpl_is_backslash && _s->escape_parse == xpl_parse_escape;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  XPL_DO_NOTHING(_s);
+XPLINTERNAL int _xpl_decode_escape(char** _d, const char** _s, const char* _e) {
+  const char* src = *_s + 1;
+  char* dst = *_d;
+  unsigned u = 0;
+  unsigned l = 0;
+  if(_e && src >= _e) return 0;
+  switch(*src++) {
+    case '"': *dst++ = '"'; break;
+    case '\\': *dst++ = '\\'; break;
+    case '/': *dst++ = '/'; break;
+    case 'b': *dst++ = '\b'; break;
+    case 'f': *dst++ = '\f'; break;
+    case 'n': *dst++ = '\n'; break;
+    case 'r': *dst++ = '\r'; break;
+    case 't': *dst++ = '\t'; break;
+    case 'u':
+      if(!_xpl_parse_hex4(src, _e, &u)) return 0;
+      src += 4;
+      if(u >= 0xd800 && u < 0xdc00 && (!_e || src + 1 < _e) && src[0] == '\\' && src[1] == 'u' &&
+        _xpl_parse_hex4(src + 2, _e, &l) && l >= 0xdc00 && l < 0xe000) {
+        u = 0x10000 + ((u - 0xd800) << 10) + (l - 0xdc00);
+        src += 6;
+      }
+      if(u < 0x80) {
+        *dst++ = (char)u;
+      } else if(u < 0x800) {
+        *dst++ = (char)(0xc0 | (u >> 6));
+        *dst++ = (char)(0x80 | (u & 0x3f));
+      } else if(u < 0x10000) {
+        *dst++ = (char)(0xe0 | (u >> 12));
+        *dst++ = (char)(0x80 | ((u >> 6) & 0x3f));
+        *dst++ = (char)(0x80 | (u & 0x3f));
+      } else {
+        *dst++ = (char)(0xf0 | (u >> 18));
+        *dst++ = (char)(0x80 | ((u >> 12) & 0x3f));
+        *dst++ = (char)(0x80 | ((u >> 6) & 0x3f));
+        *dst++ = (char)(0x80 | (u & 0x3f));
+      }
+      break;
+    default:
+      return 0;
+  }
+  *_d = dst;
+  *_s = src;
 
-  return XS_OK;
+  return 1;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  XPL_DO_NOTHING(_s);
+XPLINTERNAL int _xpl_parse_hex4(const char* _p, const char* _e, unsigned* _o) {
+  unsigned ret = 0;
+  int i = 0;
+  for(i = 0; i < 4; i++) {
+    if(_e && _p + i >= _e) return 0;
+    if(_p[i] >= '0' && _p[i] <= '9') ret = (ret << 4) | (unsigned)(_p[i] - '0');
+    else if(_p[i] >= 'a' && _p[i] <= 'f') ret = (ret << 4) | (unsigned)(_p[i] - 'a' + 10);
+    else if(_p[i] >= 'A' && _p[i] <= 'F') ret = (ret << 4) | (unsigned)(_p[i] - 'A' + 10);
+    else return 0;
+  }
+  *_o = ret;
 
-  return XS_OK;
+  return 1;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  XPL_DO_NOTHING(_s);
+XPLINTERNAL const char* _xpl_number_token(xpl_context_t* _s, const char** _b, const char** _e) {
+  const char* src = _s->cursor;
+  if(src < _s->text_end && _xpl_is_dquote(*(unsigned char*)src)) {
+    *_b = src + 1;
+    *_e = _xpl_scan_char(src + 1, _s->text_end, '"');
 
-  return XS_OK;
+    return *_e < _s->text_end && _xpl_is_dquote(*(unsigned char*)*_e) ? *_e + 1 : *_e;
+  }
+  *_b = src;
+  *_e = _xpl_scan_token_end(_s, src);
+
+  return *_e;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_or(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  _s->bool_composing = XBC_OR;
+XPLINTERNAL xpl_status_t _xpl_parse_integer(const char* _b, const char* _e, xpl_uint64_t* _o, int* _neg) {
+  xpl_uint64_t v = 0;
+  unsigned base = 10;
+  unsigned d = 0;
+  const char* p = _b;
+  *_neg = 0;
+  if(p < _e && (*p == '+' || *p == '-')) *_neg = *p++ == '-';
+  if(p + 1 < _e && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) { base = 16; p += 2; }
+  else if(p + 1 < _e && p[0] == '0' && (p[1] == 'b' || p[1] == 'B')) { base = 2; p += 2; }
+  else if(p + 1 < _e && p[0] == '0') { base = 8; p++; }
+  if(p >= _e) return XS_PARAM_TYPE_ERROR;
+  for(; p < _e; p++) {
+    if(*p >= '0' && *p <= '9') d = (unsigned)(*p - '0');
+    else if(*p >= 'a' && *p <= 'f') d = (unsigned)(*p - 'a' + 10);
+    else if(*p >= 'A' && *p <= 'F') d = (unsigned)(*p - 'A' + 10);
+    else return XS_PARAM_TYPE_ERROR;
+    if(d >= base) return XS_PARAM_TYPE_ERROR;
+    if(v > (~(xpl_uint64_t)0 - d) / base) return XS_PARAM_TYPE_ERROR;
+    v = v * base + d;
+  }
+  *_o = v;
 
   return XS_OK;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_and(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  _s->bool_composing = XBC_AND;
+XPLINTERNAL xpl_status_t _xpl_parse_double(const char* _b, const char* _e, double* _o) {
+  static const double p10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  xpl_uint64_t m = 0;
+  const char* p = _b;
+  int neg = 0;
+  int digits = 0;
+  int seen = 0;
+  int dropped = 0;
+  int exp10 = 0;
+  int e = 0;
+  int eneg = 0;
+  int i = 0;
+  if(p < _e && (*p == '+' || *p == '-')) neg = *p++ == '-';
+  for(; p < _e && *p >= '0' && *p <= '9'; p++, seen++) {
+    if(digits < 19) { m = m * 10 + (unsigned)(*p - '0'); if(m) digits++; }
+    else { exp10++; dropped |= *p != '0'; }
+  }
+  if(p < _e && *p == '.') {
+    for(p++; p < _e && *p >= '0' && *p <= '9'; p++, seen++) {
+      if(digits < 19) { m = m * 10 + (unsigned)(*p - '0'); exp10--; if(m) digits++; }
+      else { dropped |= *p != '0'; }
+    }
+  }
+  if(seen && p < _e && (*p == 'e' || *p == 'E')) {
+    p++;
+    if(p < _e && (*p == '+' || *p == '-')) eneg = *p++ == '-';
+    for(i = 0; p < _e && *p >= '0' && *p <= '9'; p++, i++) {
+      if(e < 100000) e = e * 10 + (*p - '0');
+    }
+    if(!i) return _xpl_parse_double_strtod(_b, _e, _o);
+    exp10 += eneg ? -e : e;
+  }
+  if(p != _e || !seen || dropped || m > ((xpl_uint64_t)1 << 53) || exp10 < -22 || exp10 > 22)
+    return _xpl_parse_double_strtod(_b, _e, _o);
+  *_o = exp10 < 0 ? (double)m / p10[-exp10] : (double)m * p10[exp10];
+  if(neg) *_o = -*_o;
 
   return XS_OK;
 }
 
-XPLINTERNAL xpl_status_t _xpl_core_yield(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-
-  return XS_SUSPENT;
-}
+XPLINTERNAL xpl_status_t _xpl_parse_double_strtod(const char* _b, const char* _e, double* _o) {
+  char buf[128];
+  char* conv_suc = NULL;
+  const char* dp = ".";
+  struct lconv* lc = NULL;
+  size_t l = 0;
+  size_t n = 0;
+  lc = localeconv();
+  if(lc && lc->decimal_point && lc->decimal_point[0] != '\0') dp = lc->decimal_point;
+  l = strlen(dp);
+  for(; _b < _e; _b++) {
+    if(n + (*_b == '.' ? l : 1) >= sizeof(buf)) return XS_PARAM_TYPE_ERROR;
+    if(*_b == '.') { memcpy(buf + n, dp, l); n += l; }
+    else buf[n++] = *_b;
+  }
+  if(!n) return XS_PARAM_TYPE_ERROR;
+  buf[n] = '\0';
+  *_o = strtod(buf, &conv_suc);
+  if(*conv_suc != '\0') return XS_PARAM_TYPE_ERROR;
 
-XPLINTERNAL void _xpl_skip_ifcond_body(xpl_context_t* _s) {
-  xpl_func_info_t* func = NULL;
-  int lv = _s->if_statement_depth;
-  xpl_assert(_s && _s->text);
-  do {
-    xpl_peek_func(_s, &func);
-    if(!func) {
-      XPL_SKIP_MEANINGLESS(_s);
-      _s->cursor++;
-      while(!_xpl_is_separator(*(unsigned char*)(_s->cursor), _s->separator_detect))
-        _s->cursor++;
-      continue;
-    } else if(func->func == _xpl_core_if) {
-      _s->if_statement_depth++;
-    } else if(func->func == _xpl_core_elseif || func->func == _xpl_core_else || func->func == _xpl_core_endif) {
-      if(_s->if_statement_depth == lv) break;
-      else if(func->func == _xpl_core_endif) _s->if_statement_depth--;
-    }
-    _s->cursor += strlen(func->name);
-  } while(*_s->cursor);
+  return XS_OK;
 }
 
 XPLINTERNAL int _xpl_is_squote(unsigned char _c) {
@@ -857,15 +4791,170 @@ XPLINTERNAL int _xpl_is_separator(unsigned char _c, xpl_is_separator_func _is) {
     (_is ? _is(_c) : 0);
 }
 
-XPLINTERNAL int _xpl_trim(const char** _c) {
-  int ret = 0;
-  xpl_assert(_c && *_c);
-  while(_xpl_is_blank(**_c)) {
-    ret++;
-    (*_c)++;
+XPLINTERNAL void _xpl_build_char_class(unsigned char* _cc, xpl_is_separator_func _is) {
+  int i = 0;
+  unsigned char c = 0;
+  for(i = 0; i < 256; i++) {
+    c = 0;
+    if(_xpl_is_blank((unsigned char)i)) c |= XCC_BLANK;
+    if(_xpl_is_squote((unsigned char)i)) c |= XCC_SQUOTE;
+    if(_xpl_is_dquote((unsigned char)i)) c |= XCC_DQUOTE;
+    if(_xpl_is_comma((unsigned char)i)) c |= XCC_COMMA;
+    if(_xpl_is_separator((unsigned char)i, NULL)) c |= XCC_SEPARATOR;
+    if(_xpl_is_separator((unsigned char)i, _is)) c |= XCC_SEPARATOR_EX;
+    if(i == '\0') c = XCC_END;
+    _cc[i] = c;
   }
+}
+
+XPLINTERNAL unsigned _xpl_ctz(unsigned _m) {
+#if defined(_MSC_VER)
+  unsigned long ret = 0;
+  _BitScanForward(&ret, _m);
+
+  return (unsigned)ret;
+#elif defined(__GNUC__) || defined(__clang__)
+  return (unsigned)__builtin_ctz(_m);
+#else
+  unsigned ret = 0;
+  while(!(_m & 1)) { _m >>= 1; ret++; }
 
   return ret;
+#endif
+}
+
+XPLINTERNAL XPL_NO_SANITIZE const char* _xpl_scan_char(const char* _p, const char* _e, char _c) {
+#if defined(XPL_VEC_SIZE)
+  const _XPL_VEC c = _XPL_VSET(_c);
+  const _XPL_VEC z = _XPL_VSET(0);
+  const char* a = NULL;
+  _XPL_VEC v;
+  unsigned m = 0;
+  if(_p >= _e) return _p;
+  a = _p - ((size_t)_p & (XPL_VEC_SIZE - 1));
+  v = _XPL_VLOAD(a);
+  m = _XPL_VMASK(_XPL_VOR(_XPL_VEQ(v, c), _XPL_VEQ(v, z))) >> (_p - a);
+  if(m) return _p + _xpl_ctz(m) < _e ? _p + _xpl_ctz(m) : _e;
+  for(;;) {
+    a += XPL_VEC_SIZE;
+    if(a >= _e) return _e;
+    v = _XPL_VLOAD(a);
+    m = _XPL_VMASK(_XPL_VOR(_XPL_VEQ(v, c), _XPL_VEQ(v, z)));
+    if(m) return a + _xpl_ctz(m) < _e ? a + _xpl_ctz(m) : _e;
+  }
+#else
+  while(_p < _e && *_p != '\0' && *_p != _c)
+    _p++;
+
+  return _p;
+#endif
+}
+
+XPLINTERNAL XPL_NO_SANITIZE const char* _xpl_scan_chars(const char* _p, const char* _e, char _c, char _d) {
+#if defined(XPL_VEC_SIZE)
+  const _XPL_VEC c = _XPL_VSET(_c);
+  const _XPL_VEC d = _XPL_VSET(_d);
+  const _XPL_VEC z = _XPL_VSET(0);
+  const char* a = NULL;
+  _XPL_VEC v;
+  unsigned m = 0;
+  if(_p >= _e) return _p;
+  a = _p - ((size_t)_p & (XPL_VEC_SIZE - 1));
+  v = _XPL_VLOAD(a);
+  m = _XPL_VMASK(_XPL_VOR(_XPL_VOR(_XPL_VEQ(v, c), _XPL_VEQ(v, d)), _XPL_VEQ(v, z))) >> (_p - a);
+  if(m) return _p + _xpl_ctz(m) < _e ? _p + _xpl_ctz(m) : _e;
+  for(;;) {
+    a += XPL_VEC_SIZE;
+    if(a >= _e) return _e;
+    v = _XPL_VLOAD(a);
+    m = _XPL_VMASK(_XPL_VOR(_XPL_VOR(_XPL_VEQ(v, c), _XPL_VEQ(v, d)), _XPL_VEQ(v, z)));
+    if(m) return a + _xpl_ctz(m) < _e ? a + _xpl_ctz(m) : _e;
+  }
+#else
+  while(_p < _e && *_p != '\0' && *_p != _c && *_p != _d)
+    _p++;
+
+  return _p;
+#endif
+}
+
+XPLINTERNAL XPL_NO_SANITIZE const char* _xpl_skip_blank(const char* _p, const char* _e) {
+#if defined(XPL_VEC_SIZE)
+  const _XPL_VEC sp = _XPL_VSET(' ');
+  const _XPL_VEC ht = _XPL_VSET('\t');
+  const _XPL_VEC cr = _XPL_VSET('\r');
+  const _XPL_VEC lf = _XPL_VSET('\n');
+  const char* a = NULL;
+  _XPL_VEC v;
+  unsigned m = 0;
+  if(_p >= _e || !_xpl_is_blank(*(unsigned char*)_p)) return _p;
+  a = _p - ((size_t)_p & (XPL_VEC_SIZE - 1));
+  v = _XPL_VLOAD(a);
+  m = (~_XPL_VMASK(_XPL_VOR(_XPL_VOR(_XPL_VEQ(v, sp), _XPL_VEQ(v, ht)), _XPL_VOR(_XPL_VEQ(v, cr), _XPL_VEQ(v, lf)))) & XPL_VEC_FULL) >> (_p - a);
+  if(m) return _p + _xpl_ctz(m) < _e ? _p + _xpl_ctz(m) : _e;
+  for(;;) {
+    a += XPL_VEC_SIZE;
+    if(a >= _e) return _e;
+    v = _XPL_VLOAD(a);
+    m = ~_XPL_VMASK(_XPL_VOR(_XPL_VOR(_XPL_VEQ(v, sp), _XPL_VEQ(v, ht)), _XPL_VOR(_XPL_VEQ(v, cr), _XPL_VEQ(v, lf)))) & XPL_VEC_FULL;
+    if(m) return a + _xpl_ctz(m) < _e ? a + _xpl_ctz(m) : _e;
+  }
+#else
+  while(_p < _e && _xpl_is_blank(*(unsigned char*)_p))
+    _p++;
+
+  return _p;
+#endif
+}
+
+XPLINTERNAL XPL_NO_SANITIZE const char* _xpl_scan_separator(const char* _p, const char* _e) {
+#if defined(XPL_VEC_SIZE)
+  const _XPL_VEC sp = _XPL_VSET(' ');
+  const _XPL_VEC ht = _XPL_VSET('\t');
+  const _XPL_VEC cr = _XPL_VSET('\r');
+  const _XPL_VEC lf = _XPL_VSET('\n');
+  const _XPL_VEC cm = _XPL_VSET(',');
+  const _XPL_VEC cl = _XPL_VSET(':');
+  const _XPL_VEC sq = _XPL_VSET('\'');
+  const _XPL_VEC dq = _XPL_VSET('"');
+  const _XPL_VEC z = _XPL_VSET(0);
+  const char* a = NULL;
+  const char* r = NULL;
+  _XPL_VEC v;
+  unsigned m = 0;
+  if(_p >= _e) return _p;
+  a = _p - ((size_t)_p & (XPL_VEC_SIZE - 1));
+  for(;;) {
+    v = _XPL_VLOAD(a);
+    m = _XPL_VMASK(
+      _XPL_VOR(
+        _XPL_VOR(_XPL_VOR(_XPL_VEQ(v, sp), _XPL_VEQ(v, ht)), _XPL_VOR(_XPL_VEQ(v, cr), _XPL_VEQ(v, lf))),
+        _XPL_VOR(_XPL_VOR(_XPL_VOR(_XPL_VEQ(v, cm), _XPL_VEQ(v, cl)), _XPL_VOR(_XPL_VEQ(v, sq), _XPL_VEQ(v, dq))), _XPL_VEQ(v, z))
+      )
+    );
+    if(a < _p) m >>= (_p - a);
+    if(m) {
+      r = (a < _p ? _p : a) + _xpl_ctz(m);
+
+      return r < _e ? r : _e;
+    }
+    a += XPL_VEC_SIZE;
+    if(a >= _e) return _e;
+  }
+#else
+  while(_p < _e && *_p != '\0' && !_xpl_is_separator(*(unsigned char*)_p, NULL))
+    _p++;
+
+  return _p;
+#endif
+}
+
+XPLINTERNAL const char* _xpl_scan_token_end(xpl_context_t* _s, const char* _p) {
+  if(!_s->separator_detect) return _xpl_scan_separator(_p, _s->text_end);
+  while(_p < _s->text_end && !(_s->char_class[*(unsigned char*)_p] & (XCC_SEPARATOR_EX | XCC_END)))
+    _p++;
+
+  return _p;
 }
 
 XPLINTERNAL int _xpl_strcmp(const char* _s, const char* _d) {
@@ -879,22 +4968,70 @@ XPLINTERNAL int _xpl_strcmp(const char* _s, const char* _d) {
   return ret;
 }
 
-XPLINTERNAL int _xpl_func_info_srt_cmp(const void* _l, const void* _r) {
+XPLINTERNAL unsigned _xpl_hash(const unsigned char* _cc, const char* _t, const char* _e, int* _l) {
+  unsigned ret = 2166136261u;
+  const char* t = _t;
+  while((!_e || t < _e) && !(_cc[*(unsigned char*)t] & (XCC_SEPARATOR | XCC_END))) {
+    ret = (ret ^ *(unsigned char*)t) * 16777619u;
+    t++;
+  }
+  if(_l) *_l = (int)(t - _t);
+
+  return ret & 0xffffffffu;
+}
+
+XPLINTERNAL const xpl_func_info_t* _xpl_find_func(xpl_context_t* _s, const char* _t) {
+  const xpl_registry_t* r = _s->registry;
+  const xpl_func_info_t* f = r->funcs;
+  unsigned h = 0;
+  int l = 0;
+  int lo = 0;
+  int hi = 0;
+  int m = 0;
+  /* The candidate is only known once the whole token is hashed, so the name
+     is confirmed by a second memcmp over its l bytes, still in cache. */
+  h = _xpl_hash(_s->char_class, _t, _s->text_end, &l);
+  if(r->seed) {
+    m = (int)((unsigned)r->dispatch[((h * r->seed) & 0xffffffffu) >> (32 - XPL_DISPATCH_BITS)] >> 16);
+    m = r->dispatch[_xpl_perfect_slot(h, (unsigned)m)] & 0xffff;
+    if(m != 0xffff && f[m].hash == h && f[m].length == l && !memcmp(f[m].name, _t, l))
+      return &f[m];
+
+    return NULL;
+  }
+  lo = r->dispatch[h >> (32 - XPL_DISPATCH_BITS)];
+  hi = r->dispatch[(h >> (32 - XPL_DISPATCH_BITS)) + 1];
+  while(lo < hi) {
+    m = lo + ((hi - lo) >> 1);
+    if(f[m].hash < h) lo = m + 1;
+    else hi = m;
+  }
+  for(; lo < r->funcs_count && f[lo].hash == h; lo++) {
+    if(f[lo].length == l && !memcmp(f[lo].name, _t, l))
+      return &f[lo];
+  }
+
+  return NULL;
+}
+
+XPLINTERNAL int _xpl_perfect_slot(unsigned _h, unsigned _d) {
+  unsigned x = (_h ^ (_d * 0x9e3779b9u)) & 0xffffffffu;
+  x ^= x >> 16;
+  x = (x * 0x85ebca6bu) & 0xffffffffu;
+
+  return (int)(x >> (32 - XPL_DISPATCH_BITS));
+}
+
+XPLINTERNAL int _xpl_func_info_hash_cmp(const void* _l, const void* _r) {
   xpl_func_info_t* l = (xpl_func_info_t*)_l;
   xpl_func_info_t* r = (xpl_func_info_t*)_r;
   xpl_assert(l && r);
+  if(l->hash < r->hash) return -1;
+  else if(l->hash > r->hash) return 1;
 
   return _xpl_strcmp(l->name, r->name);
 }
 
-XPLINTERNAL int _xpl_func_info_sch_cmp(const void* _k, const void* _i) {
-  const char* k = (const char*)_k;
-  xpl_func_info_t* i = (xpl_func_info_t*)_i;
-  xpl_assert(k && i);
-
-  return _xpl_strcmp(k, i->name);
-}
-
 /* ========================================================} */
 
 #ifdef __cplusplus
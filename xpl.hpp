@@ -0,0 +1,301 @@
+/**
+ * Author: Wang Renxin, hellotony521@qq.com
+ * For the latest info, see https://github.com/paladin-t/xpl/
+ * Created:     Oct. 14, 2011
+ * Last edited: Jun. 17, 2017
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+/**
+ * Optional C++17 front end of xpl.h, include it instead of xpl.h. The
+ * XPL_FUNC_BEGIN/XPL_FUNC_ADD/XPL_FUNC_END macros declare a constexpr
+ * interface table with a two level perfect hash dispatch index computed at
+ * compile time, so opening a context neither hashes nor sorts, and finding an
+ * interface takes a bucket and a slot probe. Tables go to the usual xpl_open and
+ * xpl_registry_build through overloads, the rest of the C API is unchanged.
+ */
+
+#ifndef __XPL_HPP__
+#define __XPL_HPP__
+
+#if !defined(__cplusplus) || (__cplusplus < 201703L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#  error "xpl.hpp requires C++17."
+#endif /* C++17 */
+
+#include <cstddef>
+
+/**
+ * @brief XPL scripting programming interface registering macros, which
+ *  declare a constexpr interface table.
+ * @note Defined before xpl.h, so the macros of xpl.h are not used; if xpl.h
+ *  was already included, the plain interface array macros remain.
+ */
+#ifndef XPL_FUNC_REGISTER
+#  define XPL_FUNC_REGISTER
+/**< Begins an interface declaration without buildin interfaces. */
+#  define XPL_FUNC_BEGIN_EMPTY(a) \
+    static constexpr auto a = xpl_make_table({
+/**< Begins an interface declaration with buildin interfaces. */
+#  define XPL_FUNC_BEGIN(a) \
+    static constexpr auto a = xpl_make_table({ \
+      { "if", _xpl_core_if, 0, 0, 0, "_xpl_core_if" }, \
+      { "then", _xpl_core_then, 0, 0, 0, "_xpl_core_then" }, \
+      { "elseif", _xpl_core_elseif, 0, 0, 0, "_xpl_core_elseif" }, \
+      { "else", _xpl_core_else, 0, 0, 0, "_xpl_core_else" }, \
+      { "endif", _xpl_core_endif, 0, 0, 0, "_xpl_core_endif" }, \
+      { "or", _xpl_core_or, 0, 0, 0, "_xpl_core_or" }, \
+      { "and", _xpl_core_and, 0, 0, 0, "_xpl_core_and" }, \
+      { "yield", _xpl_core_yield, 0, 0, 0, "_xpl_core_yield" },
+/**< Declares an interface. */
+#  define XPL_FUNC_ADD(n, f) \
+      { n, f, 0, 0, 0, #f },
+/**< Declares an interface with flags of xpl_func_flags_t. */
+#  define XPL_FUNC_ADD_FLAGS(n, f, g) \
+      { n, f, g, 0, 0, #f },
+/**< Ends an interface declaration. */
+#  define XPL_FUNC_END \
+      { nullptr, nullptr, 0, 0, 0, nullptr } \
+    });
+#endif /* !XPL_FUNC_REGISTER */
+
+#include "xpl.h"
+
+/**
+ * @brief Max displacements tried for a bucket when searching a perfect hash
+ *  at compile time, at most 32768.
+ */
+#ifndef XPL_PERFECT_HASH_TRIES
+#  define XPL_PERFECT_HASH_TRIES 4096
+#endif /* !XPL_PERFECT_HASH_TRIES */
+
+/**
+ * @brief Max bucket multipliers tried when searching a perfect hash at
+ *  compile time.
+ */
+#ifndef XPL_PERFECT_HASH_SEEDS
+#  define XPL_PERFECT_HASH_SEEDS 16
+#endif /* !XPL_PERFECT_HASH_SEEDS */
+
+/**
+ * @brief Interface table with a two level perfect hash dispatch index, the
+ *  layout of xpl_registry_build_perfect.
+ */
+template<std::size_t N> struct xpl_table_t {
+  xpl_func_info_t funcs[N + 1];         /**< Interfaces, terminated by an empty one. */
+  int dispatch[1 << XPL_DISPATCH_BITS]; /**< Bucket displacement in high 16 bits, slot interface index in low 16 bits, 0xffff if empty. */
+  unsigned seed;                        /**< Odd multiplier of perfect hash buckets. */
+
+  /**
+   * @brief Finds an interface by name, usable in constant expressions.
+   *
+   * @param[in] _n - Interface name.
+   * @return - Returns index of found interface, or -1 if not found.
+   */
+  constexpr int find(const char* _n) const;
+};
+
+/**
+ * @brief Hashes an interface name the same way as _xpl_hash.
+ *
+ * @param[in] _t  - Interface name.
+ * @param[out] _l - Length of the name.
+ * @return - Returns hash value.
+ */
+constexpr unsigned _xpl_ct_hash(const char* _t, int* _l) {
+  unsigned ret = 2166136261u;
+  int l = 0;
+  for(; _t[l]; l++)
+    ret = ((ret ^ (unsigned char)_t[l]) * 16777619u) & 0xffffffffu;
+  *_l = l;
+
+  return ret;
+}
+
+/**
+ * @brief Gets the perfect hash bucket of a hash value.
+ *
+ * @param[in] _h - Hash value.
+ * @param[in] _m - Multiplier.
+ * @return - Returns bucket index.
+ */
+constexpr int _xpl_ct_bucket(unsigned _h, unsigned _m) {
+  return (int)(((_h * _m) & 0xffffffffu) >> (32 - XPL_DISPATCH_BITS));
+}
+
+/**
+ * @brief Gets the displaced slot of a hash value the same way as
+ *  _xpl_perfect_slot.
+ *
+ * @param[in] _h - Hash value.
+ * @param[in] _d - Displacement of the bucket.
+ * @return - Returns slot index.
+ */
+constexpr int _xpl_ct_slot(unsigned _h, unsigned _d) {
+  unsigned x = (_h ^ (_d * 0x9e3779b9u)) & 0xffffffffu;
+  x ^= x >> 16;
+  x = (x * 0x85ebca6bu) & 0xffffffffu;
+
+  return (int)(x >> (32 - XPL_DISPATCH_BITS));
+}
+
+/**
+ * @brief Compares two names.
+ *
+ * @return - Returns non-zero if equal.
+ */
+constexpr int _xpl_ct_same(const char* _l, const char* _r) {
+  while(*_l && *_l == *_r) { _l++; _r++; }
+
+  return *_l == *_r;
+}
+
+/**
+ * @brief Breaks constant evaluation of a table if two interfaces share a
+ *  name or a hash value.
+ */
+inline void _xpl_ct_collided(void) { xpl_assert(0 && "Interfaces collided"); }
+
+/**
+ * @brief Breaks constant evaluation of a table if no perfect hash is found,
+ *  raise XPL_DISPATCH_BITS, XPL_PERFECT_HASH_TRIES or XPL_PERFECT_HASH_SEEDS.
+ */
+inline void _xpl_ct_not_found(void) { xpl_assert(0 && "Perfect hash not found"); }
+
+template<std::size_t N> constexpr int xpl_table_t<N>::find(const char* _n) const {
+  int l = 0;
+  unsigned h = _xpl_ct_hash(_n, &l);
+  unsigned d = (unsigned)dispatch[_xpl_ct_bucket(h, seed)] >> 16;
+  int i = dispatch[_xpl_ct_slot(h, d)] & 0xffff;
+  if(i == 0xffff || funcs[i].hash != h || !_xpl_ct_same(funcs[i].name, _n)) return -1;
+
+  return i;
+}
+
+/**
+ * @brief Places interfaces into perfect hash slots with a bucket multiplier,
+ *  buckets are placed from the largest, each by the first displacement which
+ *  maps all its interfaces to free and distinct slots.
+ *
+ * @param[in][out] _t - Interface table with hashes filled.
+ * @param[in] _n      - Count of interfaces.
+ * @param[in] _m      - Bucket multiplier.
+ * @return - Returns true if all buckets are placed.
+ */
+template<std::size_t N> constexpr bool _xpl_ct_place(xpl_table_t<N>& _t, std::size_t _n, unsigned _m) {
+  int size[1 << XPL_DISPATCH_BITS]{};
+  int slot[1 << XPL_DISPATCH_BITS]{};
+  int stamp[1 << XPL_DISPATCH_BITS]{};
+  int largest = 0;
+  int attempt = 0;
+  int z = 0;
+  int b = 0;
+  int d = 0;
+  int s = 0;
+  std::size_t i = 0;
+  bool placed = false;
+  for(i = 0; i < _n; i++) {
+    b = _xpl_ct_bucket(_t.funcs[i].hash, _m);
+    if(++size[b] > largest) largest = size[b];
+  }
+  for(s = 0; s < (1 << XPL_DISPATCH_BITS); s++)
+    slot[s] = -1;
+  for(z = largest; z > 0; z--) {
+    for(b = 0; b < (1 << XPL_DISPATCH_BITS); b++) {
+      if(size[b] != z) continue;
+      placed = false;
+      for(d = 0; d < XPL_PERFECT_HASH_TRIES && !placed; d++) {
+        attempt++;
+        placed = true;
+        for(i = 0; i < _n && placed; i++) {
+          if(_xpl_ct_bucket(_t.funcs[i].hash, _m) != b) continue;
+          s = _xpl_ct_slot(_t.funcs[i].hash, (unsigned)d);
+          if(slot[s] >= 0 || stamp[s] == attempt) placed = false;
+          stamp[s] = attempt;
+        }
+      }
+      if(!placed) return false;
+      d--;
+      for(i = 0; i < _n; i++) {
+        if(_xpl_ct_bucket(_t.funcs[i].hash, _m) == b) slot[_xpl_ct_slot(_t.funcs[i].hash, (unsigned)d)] = (int)i;
+      }
+      _t.dispatch[b] = d << 16;
+    }
+  }
+  for(s = 0; s < (1 << XPL_DISPATCH_BITS); s++)
+    _t.dispatch[s] |= slot[s] < 0 ? 0xffff : slot[s];
+  _t.seed = _m;
+
+  return true;
+}
+
+/**
+ * @brief Makes an interface table, finds a two level perfect hash which maps
+ *  the hash of every interface name to a distinct slot.
+ *
+ * @param[in] _f - Interfaces, terminated by an empty one.
+ * @return - Returns made table.
+ */
+template<std::size_t N> constexpr xpl_table_t<N - 1> xpl_make_table(const xpl_func_info_t (&_f)[N]) {
+  xpl_table_t<N - 1> ret{};
+  unsigned m = 2654435761u;
+  std::size_t i = 0;
+  std::size_t j = 0;
+  int t = 0;
+  static_assert(N - 1 <= (1 << XPL_DISPATCH_BITS), "Too many interfaces for XPL_DISPATCH_BITS, at most 1 << XPL_DISPATCH_BITS.");
+  static_assert(XPL_DISPATCH_BITS <= 15 && XPL_PERFECT_HASH_TRIES <= 32768, "Dispatch entries hold 16 bits of displacement and of index.");
+  for(i = 0; i < N; i++)
+    ret.funcs[i] = _f[i];
+  for(i = 0; i < N - 1; i++) {
+    ret.funcs[i].hash = _xpl_ct_hash(_f[i].name, &ret.funcs[i].length);
+    for(j = 0; j < i; j++) {
+      if(ret.funcs[j].hash == ret.funcs[i].hash) _xpl_ct_collided();
+    }
+  }
+  for(t = 0; t < XPL_PERFECT_HASH_SEEDS; t++, m += 0x6a09e668u) {
+    for(i = 0; i < (std::size_t)(1 << XPL_DISPATCH_BITS); i++)
+      ret.dispatch[i] = 0;
+    if(_xpl_ct_place(ret, N - 1, m | 1u)) break;
+  }
+  if(t == XPL_PERFECT_HASH_SEEDS) _xpl_ct_not_found();
+
+  return ret;
+}
+
+/**
+ * @brief Builds an interface registry from an interface table.
+ *
+ * @param[out] _r - Interface registry.
+ * @param[in] _t  - Interface table, which must outlive the registry.
+ * @return - Returns execution status.
+ */
+template<std::size_t N> inline xpl_status_t xpl_registry_build(xpl_registry_t* _r, const xpl_table_t<N>& _t) {
+  return xpl_registry_build_perfect(_r, _t.funcs, _t.seed, _t.dispatch);
+}
+
+/**
+ * @brief Opens an XPL context with an interface table.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _t  - Interface table, which must outlive the context.
+ * @param[in] _is - Separator determination functor.
+ * @return - Returns execution status.
+ */
+template<std::size_t N> inline xpl_status_t xpl_open(xpl_context_t* _s, const xpl_table_t<N>& _t, xpl_is_separator_func _is) {
+  xpl_registry_t* reg = NULL;
+  xpl_assert(_s);
+  memset(_s, 0, sizeof(xpl_context_t));
+  reg = (xpl_registry_t*)XPL_MALLOC(sizeof(xpl_registry_t));
+  if(!reg) return XS_ERR;
+  xpl_registry_build(reg, _t);
+  xpl_open_registry(_s, reg, _is);
+  _s->own_registry = reg;
+
+  return XS_OK;
+}
+
+#endif /* !__XPL_HPP__ */